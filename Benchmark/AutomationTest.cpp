@@ -0,0 +1,83 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+#include <cstdio>
+
+// Checks sample-accurate automation in the block that wakes the processor
+// up after silence. The parameters that have changes in that block must
+// start from their current values, not from where reset() left them.
+
+static int failures = 0;
+
+static void check(bool condition, const juce::String& what)
+{
+    if (!condition) {
+        std::printf("FAILED: %s\n", what.toRawUTF8());
+        ++failures;
+    }
+}
+
+static void setParameter(DelayAudioProcessor& processor, const char* id, float value)
+{
+    auto* param = processor.apvts.getParameter(id);
+    param->setValueNotifyingHost(param->convertTo0to1(value));
+}
+
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    DelayAudioProcessor processor;
+
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+
+    // A 5 ms delay and a 7 ms tap, so that both echoes of an impulse at the
+    // start of the block come before the changes at sample 400.
+    setParameter(processor, "delayTime", 5.0f);
+    setParameter(processor, "feedback", 0.0f);
+    setParameter(processor, "mix", 100.0f);
+    setParameter(processor, "tap1Time", 7.0f);
+    setParameter(processor, "tap1Level", 100.0f);
+
+    processor.setNonRealtime(true);
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    // Longer than the delay lines, so the processor goes idle.
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midi;
+    int silentBlocks = int(std::ceil(6.0 * sampleRate / blockSize));
+    for (int block = 0; block < silentBlocks; ++block) {
+        buffer.clear();
+        processor.processBlock(buffer, midi);
+    }
+
+    // The host sends the values the parameters already have, at sample 400.
+    std::vector<Parameters::Change> changes;
+    for (const char* id : { "delayTime", "tap1Time", "tap1Level" }) {
+        auto* param = processor.apvts.getParameter(id);
+        changes.push_back({ 400, param->getParameterIndex(), param->getValue() });
+    }
+
+    buffer.clear();
+    buffer.setSample(0, 0, 1.0f);
+    buffer.setSample(1, 0, 1.0f);
+    processor.setParameterChanges(changes.data(), int(changes.size()));
+    processor.processBlock(buffer, midi);
+    processor.setParameterChanges(nullptr, 0);
+
+    int delaySample = juce::roundToInt(0.005 * sampleRate);
+    int tapSample = juce::roundToInt(0.007 * sampleRate);
+    for (int channel = 0; channel < 2; ++channel) {
+        juce::String name = channel == 0 ? "left" : "right";
+        check(std::abs(buffer.getSample(channel, delaySample)) > 0.5f, "no delayed impulse on the " + name);
+        check(std::abs(buffer.getSample(channel, tapSample)) > 0.5f, "no tap impulse on the " + name);
+    }
+
+    processor.releaseResources();
+
+    if (failures == 0) {
+        std::printf("Automation OK\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
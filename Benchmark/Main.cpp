@@ -0,0 +1,558 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "DelayLine.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+// Offline render + throughput benchmark for DelayAudioProcessor. The
+// processor is created without an editor and driven through prepareToPlay()
+// and processBlock() exactly like a host would, for every combination of
+// channel layout, sample rate and block size asked for.
+//
+// With --delay-lines it benchmarks the stereo delay line layouts instead:
+// two DelayLine objects side by side against one InterleavedDelayLine<2>.
+
+struct Layout
+{
+    juce::String name;
+    juce::AudioChannelSet input;
+    juce::AudioChannelSet output;
+};
+
+// A parameter change at a point in time, for --automate.
+struct Automation
+{
+    juce::String id;
+    float value = 0.0f;
+    double seconds = 0.0;
+};
+
+struct Options
+{
+    juce::Array<Layout> layouts;
+    juce::Array<double> sampleRates { 44100.0, 48000.0, 96000.0, 192000.0 };
+    juce::Array<int> blockSizes { 32, 64, 128, 256, 512, 1024 };
+    double seconds = 10.0;
+    juce::File inputFile;
+    juce::File outputFile;
+    juce::StringPairArray parameters;
+    juce::Array<Automation> automation;
+    bool csv = false;
+    bool delayLines = false;
+    juce::Array<double> delayTimes { 10.0, 1000.0, 5000.0 };  // milliseconds
+};
+
+struct Result
+{
+    double nsPerSample = 0.0;
+    double realtimeFactor = 0.0;
+    double p50 = 0.0;  // block times in microseconds
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+static const Layout allLayouts[] = {
+    { "mono-mono", juce::AudioChannelSet::mono(), juce::AudioChannelSet::mono() },
+    { "mono-stereo", juce::AudioChannelSet::mono(), juce::AudioChannelSet::stereo() },
+    { "stereo-stereo", juce::AudioChannelSet::stereo(), juce::AudioChannelSet::stereo() },
+};
+
+static void printUsage()
+{
+    std::cout
+        << "Usage: DelayBenchmark [options]\n"
+        << "  --layouts=mono-mono,mono-stereo,stereo-stereo\n"
+        << "  --sample-rates=44100,48000,96000,192000\n"
+        << "  --block-sizes=32,64,128,256,512,1024\n"
+        << "  --seconds=10           length of audio rendered per run\n"
+        << "  --input=file.wav       use this instead of white noise (looped)\n"
+        << "  --output=file.wav      render the input once with the first layout,\n"
+        << "                         sample rate and block size, and save it\n"
+        << "  --set=id=value         set a parameter, e.g. --set=feedback=80\n"
+        << "  --automate=id=value@s  with --output, change a parameter at exactly\n"
+        << "                         that time, e.g. --automate=delayTime=250@1.5\n"
+        << "  --csv                  print results as CSV\n"
+        << "  --delay-lines          compare separate and interleaved stereo delay\n"
+        << "                         lines instead of running the plug-in\n"
+        << "  --delay-times=10,1000,5000\n"
+        << "                         delay times in ms for --delay-lines\n";
+}
+
+static juce::StringArray splitList(const juce::String& text)
+{
+    return juce::StringArray::fromTokens(text, ",", "");
+}
+
+static bool parseOptions(const juce::ArgumentList& args, Options& options)
+{
+    if (args.containsOption("--layouts")) {
+        for (const auto& name : splitList(args.getValueForOption("--layouts"))) {
+            bool found = false;
+            for (const auto& layout : allLayouts) {
+                if (layout.name == name.trim()) {
+                    options.layouts.add(layout);
+                    found = true;
+                }
+            }
+            if (!found) {
+                std::cerr << "Unknown layout: " << name << "\n";
+                return false;
+            }
+        }
+    } else {
+        for (const auto& layout : allLayouts) {
+            options.layouts.add(layout);
+        }
+    }
+
+    if (args.containsOption("--sample-rates")) {
+        options.sampleRates.clear();
+        for (const auto& rate : splitList(args.getValueForOption("--sample-rates"))) {
+            options.sampleRates.add(rate.getDoubleValue());
+        }
+    }
+
+    if (args.containsOption("--block-sizes")) {
+        options.blockSizes.clear();
+        for (const auto& size : splitList(args.getValueForOption("--block-sizes"))) {
+            options.blockSizes.add(size.getIntValue());
+        }
+    }
+
+    if (args.containsOption("--seconds")) {
+        options.seconds = args.getValueForOption("--seconds").getDoubleValue();
+    }
+    if (args.containsOption("--input")) {
+        options.inputFile = args.getExistingFileForOption("--input");
+    }
+    if (args.containsOption("--output")) {
+        options.outputFile = args.getFileForOption("--output");
+    }
+
+    for (const auto& arg : args.arguments) {
+        if (arg.text.startsWith("--set=")) {
+            auto assignment = arg.text.fromFirstOccurrenceOf("=", false, false);
+            options.parameters.set(assignment.upToFirstOccurrenceOf("=", false, false),
+                                   assignment.fromFirstOccurrenceOf("=", false, false));
+        } else if (arg.text.startsWith("--automate=")) {
+            auto assignment = arg.text.fromFirstOccurrenceOf("=", false, false);
+            auto value = assignment.fromFirstOccurrenceOf("=", false, false);
+            Automation automation;
+            automation.id = assignment.upToFirstOccurrenceOf("=", false, false);
+            automation.value = value.upToFirstOccurrenceOf("@", false, false).getFloatValue();
+            automation.seconds = value.fromFirstOccurrenceOf("@", false, false).getDoubleValue();
+            options.automation.add(automation);
+        }
+    }
+
+    options.csv = args.containsOption("--csv");
+    options.delayLines = args.containsOption("--delay-lines");
+
+    if (args.containsOption("--delay-times")) {
+        options.delayTimes.clear();
+        for (const auto& time : splitList(args.getValueForOption("--delay-times"))) {
+            options.delayTimes.add(time.getDoubleValue());
+        }
+    }
+    for (auto time : options.delayTimes) {
+        if (time <= 0.0 || time > Parameters::maxDelayTime) {
+            std::cerr << "Delay times must be between 0 and " << Parameters::maxDelayTime << " ms\n";
+            return false;
+        }
+    }
+
+    for (auto size : options.blockSizes) {
+        if (size <= 0) {
+            std::cerr << "Block sizes must be positive\n";
+            return false;
+        }
+    }
+    for (auto rate : options.sampleRates) {
+        if (rate <= 0.0) {
+            std::cerr << "Sample rates must be positive\n";
+            return false;
+        }
+    }
+    return options.seconds > 0.0 && !options.layouts.isEmpty();
+}
+
+static juce::AudioBuffer<float> loadSource(const Options& options)
+{
+    juce::AudioBuffer<float> source;
+
+    if (options.inputFile != juce::File()) {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(options.inputFile));
+        if (reader != nullptr && reader->lengthInSamples > 0) {
+            source.setSize(int(reader->numChannels), int(reader->lengthInSamples));
+            reader->read(&source, 0, source.getNumSamples(), 0, true, true);
+            return source;
+        }
+        std::cerr << "Could not read " << options.inputFile.getFullPathName() << ", using noise\n";
+    }
+
+    // One second of white noise at -12 dB, with a fixed seed so that runs
+    // are repeatable.
+    juce::Random random(1234);
+    source.setSize(2, 48000);
+    for (int channel = 0; channel < source.getNumChannels(); ++channel) {
+        float* data = source.getWritePointer(channel);
+        for (int sample = 0; sample < source.getNumSamples(); ++sample) {
+            data[sample] = (random.nextFloat() * 2.0f - 1.0f) * 0.25f;
+        }
+    }
+    return source;
+}
+
+static bool prepareProcessor(DelayAudioProcessor& processor, const Options& options,
+                             const Layout& layout, double sampleRate, int blockSize)
+{
+    juce::AudioProcessor::BusesLayout busesLayout;
+    busesLayout.inputBuses.add(layout.input);
+    busesLayout.outputBuses.add(layout.output);
+
+    if (!processor.setBusesLayout(busesLayout)) {
+        std::cerr << "Layout " << layout.name << " is not supported\n";
+        return false;
+    }
+
+    auto keys = options.parameters.getAllKeys();
+    for (const auto& key : keys) {
+        auto* param = processor.apvts.getParameter(key);
+        if (param == nullptr) {
+            std::cerr << "Unknown parameter: " << key << "\n";
+            return false;
+        }
+        float value = options.parameters[key].getFloatValue();
+        param->setValueNotifyingHost(param->convertTo0to1(value));
+    }
+
+    // Nothing here runs in real time, and there is no message loop to grow
+    // the delay lines while rendering, so they're full size from the start.
+    processor.setNonRealtime(true);
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+    return true;
+}
+
+// Copies the next numSamples of the (looped) source into the input channels.
+static void fillInput(juce::AudioBuffer<float>& buffer, int numInputChannels,
+                      const juce::AudioBuffer<float>& source, int& readPos, int numSamples)
+{
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
+        if (channel >= numInputChannels) {
+            buffer.clear(channel, 0, numSamples);
+            continue;
+        }
+        const float* src = source.getReadPointer(channel % source.getNumChannels());
+        float* dest = buffer.getWritePointer(channel);
+        int pos = readPos;
+        for (int sample = 0; sample < numSamples; ++sample) {
+            dest[sample] = src[pos];
+            if (++pos == source.getNumSamples()) {
+                pos = 0;
+            }
+        }
+    }
+    readPos = (readPos + numSamples) % source.getNumSamples();
+}
+
+static bool runBenchmark(const Options& options, const juce::AudioBuffer<float>& source,
+                         const Layout& layout, double sampleRate, int blockSize, Result& result)
+{
+    DelayAudioProcessor processor;
+    if (!prepareProcessor(processor, options, layout, sampleRate, blockSize)) {
+        return false;
+    }
+
+    int numChannels = std::max(layout.input.size(), layout.output.size());
+    juce::AudioBuffer<float> buffer(numChannels, blockSize);
+    juce::MidiBuffer midi;
+    int readPos = 0;
+
+    // Warm up the caches and let the smoothers settle before measuring.
+    int warmupBlocks = int(std::ceil(sampleRate / blockSize));
+    for (int block = 0; block < warmupBlocks; ++block) {
+        fillInput(buffer, layout.input.size(), source, readPos, blockSize);
+        processor.processBlock(buffer, midi);
+    }
+
+    int numBlocks = int(std::ceil(options.seconds * sampleRate / blockSize));
+    std::vector<double> blockTimes;
+    blockTimes.reserve(size_t(numBlocks));
+    double totalNs = 0.0;
+
+    for (int block = 0; block < numBlocks; ++block) {
+        fillInput(buffer, layout.input.size(), source, readPos, blockSize);
+
+        auto start = std::chrono::steady_clock::now();
+        processor.processBlock(buffer, midi);
+        auto end = std::chrono::steady_clock::now();
+
+        double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        blockTimes.push_back(ns);
+        totalNs += ns;
+    }
+
+    processor.releaseResources();
+
+    std::sort(blockTimes.begin(), blockTimes.end());
+    auto percentile = [&blockTimes](double q) {
+        size_t index = size_t(std::ceil(q * double(blockTimes.size())));
+        return blockTimes[std::min(blockTimes.size() - 1, index > 0 ? index - 1 : 0)] * 0.001;
+    };
+
+    double numSamples = double(numBlocks) * blockSize;
+    result.nsPerSample = totalNs / numSamples;
+    result.realtimeFactor = (numSamples / sampleRate) / (totalNs * 1e-9);
+    result.p50 = percentile(0.50);
+    result.p99 = percentile(0.99);
+    result.max = blockTimes.back() * 0.001;
+    return true;
+}
+
+// Nanoseconds per stereo frame for one read and one write of the delay
+// lines, with the delay either fixed or slowly modulated, which takes the
+// gathering read path. Both layouts see the same input and delays.
+struct DelayLineResult
+{
+    double separateFixed = 0.0;
+    double interleavedFixed = 0.0;
+    double separateMoving = 0.0;
+    double interleavedMoving = 0.0;
+};
+
+static DelayLineResult runDelayLineBenchmark(const Options& options, const juce::AudioBuffer<float>& source,
+                                             double sampleRate, int blockSize, double delayTime)
+{
+    float delay = float(delayTime / 1000.0 * sampleRate);
+    float depth = std::min(0.25f * delay, float(0.002 * sampleRate));
+    delay = std::max(delay, float(blockSize + 2) + depth);
+    int maxDelay = int(std::ceil(delay + depth)) + 1;
+
+    DelayLine delayLineL, delayLineR;
+    InterleavedDelayLine<2> interleaved;
+    delayLineL.setMaximumDelayInSamples(maxDelay);
+    delayLineR.setMaximumDelayInSamples(maxDelay);
+    interleaved.setMaximumDelayInSamples(maxDelay);
+    delayLineL.reset();
+    delayLineR.reset();
+    interleaved.reset();
+
+    juce::AudioBuffer<float> input(2, blockSize);
+    juce::AudioBuffer<float> output(2, blockSize);
+    std::vector<float> delays(size_t(blockSize));
+    int readPos = 0;
+
+    // Run for the whole delay first, so the reads hit real data and the
+    // buffers have been touched at least once.
+    int warmupBlocks = int(std::ceil(double(maxDelay) / blockSize));
+    int numBlocks = int(std::ceil(options.seconds * sampleRate / blockSize));
+    double separateNs[2] = { 0.0, 0.0 };
+    double interleavedNs[2] = { 0.0, 0.0 };
+    double phase = 0.0;
+
+    for (int block = 0; block < warmupBlocks + numBlocks; ++block) {
+        fillInput(input, 2, source, readPos, blockSize);
+        bool moving = block % 2 == 1;
+        for (int i = 0; i < blockSize; ++i) {
+            delays[size_t(i)] = delay + depth * float(std::sin(phase));
+            phase += 0.5 * juce::MathConstants<double>::twoPi / sampleRate;  // 0.5 Hz
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (moving) {
+            delayLineL.readBlock(output.getWritePointer(0), delays.data(), blockSize);
+            delayLineR.readBlock(output.getWritePointer(1), delays.data(), blockSize);
+        } else {
+            delayLineL.readBlock(output.getWritePointer(0), delay, blockSize);
+            delayLineR.readBlock(output.getWritePointer(1), delay, blockSize);
+        }
+        delayLineL.writeBlock(input.getReadPointer(0), blockSize);
+        delayLineR.writeBlock(input.getReadPointer(1), blockSize);
+        auto middle = std::chrono::steady_clock::now();
+        if (moving) {
+            interleaved.readBlock(output.getArrayOfWritePointers(), delays.data(), blockSize);
+        } else {
+            interleaved.readBlock(output.getArrayOfWritePointers(), delay, blockSize);
+        }
+        interleaved.writeBlock(input.getArrayOfReadPointers(), blockSize);
+        auto end = std::chrono::steady_clock::now();
+
+        if (block >= warmupBlocks) {
+            separateNs[moving] += double(std::chrono::duration_cast<std::chrono::nanoseconds>(middle - start).count());
+            interleavedNs[moving] += double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - middle).count());
+        }
+    }
+
+    // Half of the blocks used each read path.
+    double numFrames = 0.5 * double(numBlocks) * blockSize;
+    DelayLineResult result;
+    result.separateFixed = separateNs[0] / numFrames;
+    result.interleavedFixed = interleavedNs[0] / numFrames;
+    result.separateMoving = separateNs[1] / numFrames;
+    result.interleavedMoving = interleavedNs[1] / numFrames;
+    return result;
+}
+
+static void runDelayLineBenchmarks(const Options& options, const juce::AudioBuffer<float>& source)
+{
+    if (options.csv) {
+        std::printf("sample_rate,delay_ms,block_size,separate_fixed_ns,interleaved_fixed_ns,"
+                    "separate_moving_ns,interleaved_moving_ns\n");
+    } else {
+        std::printf("%8s %8s %6s %14s %14s %14s %14s\n", "rate", "delay ms", "block",
+                    "separate", "interleaved", "separate mod", "interl. mod");
+    }
+
+    for (auto sampleRate : options.sampleRates) {
+        for (auto delayTime : options.delayTimes) {
+            for (auto blockSize : options.blockSizes) {
+                auto result = runDelayLineBenchmark(options, source, sampleRate, blockSize, delayTime);
+
+                const char* format = options.csv
+                    ? "%.0f,%.0f,%d,%.3f,%.3f,%.3f,%.3f\n"
+                    : "%8.0f %8.0f %6d %14.3f %14.3f %14.3f %14.3f\n";
+                std::printf(format, sampleRate, delayTime, blockSize, result.separateFixed,
+                            result.interleavedFixed, result.separateMoving, result.interleavedMoving);
+                std::fflush(stdout);
+            }
+        }
+    }
+}
+
+static bool renderToFile(const Options& options, const juce::AudioBuffer<float>& source)
+{
+    const auto& layout = options.layouts.getReference(0);
+    double sampleRate = options.sampleRates[0];
+    int blockSize = options.blockSizes[0];
+
+    DelayAudioProcessor processor;
+    if (!prepareProcessor(processor, options, layout, sampleRate, blockSize)) {
+        return false;
+    }
+
+    int length = int(std::ceil(options.seconds * sampleRate));
+    int numChannels = std::max(layout.input.size(), layout.output.size());
+    juce::AudioBuffer<float> buffer(numChannels, blockSize);
+    juce::AudioBuffer<float> rendered(layout.output.size(), length);
+    juce::MidiBuffer midi;
+    int readPos = 0;
+
+    // Sorted by time, so every block's changes come out in order.
+    auto automation = options.automation;
+    std::stable_sort(automation.begin(), automation.end(), [](const auto& a, const auto& b) {
+        return a.seconds < b.seconds;
+    });
+    for (const auto& change : automation) {
+        if (processor.apvts.getParameter(change.id) == nullptr) {
+            std::cerr << "Unknown parameter: " << change.id << "\n";
+            return false;
+        }
+    }
+    std::vector<Parameters::Change> changes;
+    changes.reserve(size_t(automation.size()));
+    int nextAutomation = 0;
+
+    for (int pos = 0; pos < length; pos += blockSize) {
+        int numSamples = std::min(blockSize, length - pos);
+        buffer.setSize(numChannels, numSamples, false, false, true);
+        fillInput(buffer, layout.input.size(), source, readPos, numSamples);
+
+        // Like a host with sample-accurate automation: the parameter gets
+        // its new value before the block, and the processor is told where
+        // in the block the change happens.
+        changes.clear();
+        while (nextAutomation < automation.size()) {
+            const auto& change = automation.getReference(nextAutomation);
+            int offset = int(std::round(change.seconds * sampleRate)) - pos;
+            if (offset >= numSamples) {
+                break;
+            }
+            auto* param = processor.apvts.getParameter(change.id);
+            float value = param->convertTo0to1(change.value);
+            param->setValueNotifyingHost(value);
+            changes.push_back({ std::max(0, offset), param->getParameterIndex(), value });
+            ++nextAutomation;
+        }
+        processor.setParameterChanges(changes.data(), int(changes.size()));
+        processor.processBlock(buffer, midi);
+        for (int channel = 0; channel < rendered.getNumChannels(); ++channel) {
+            rendered.copyFrom(channel, pos, buffer, channel, 0, numSamples);
+        }
+    }
+
+    options.outputFile.deleteFile();
+    std::unique_ptr<juce::OutputStream> stream = options.outputFile.createOutputStream();
+    if (stream == nullptr) {
+        std::cerr << "Could not write " << options.outputFile.getFullPathName() << "\n";
+        return false;
+    }
+
+    juce::WavAudioFormat format;
+    std::unique_ptr<juce::AudioFormatWriter> writer(
+        format.createWriterFor(stream.get(), sampleRate, juce::uint32(rendered.getNumChannels()), 24, {}, 0));
+    if (writer == nullptr) {
+        return false;
+    }
+    stream.release();  // now owned by the writer
+    return writer->writeFromAudioSampleBuffer(rendered, 0, rendered.getNumSamples());
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h")) {
+        printUsage();
+        return 0;
+    }
+
+    Options options;
+    if (!parseOptions(args, options)) {
+        printUsage();
+        return 1;
+    }
+
+    auto source = loadSource(options);
+
+    if (options.outputFile != juce::File()) {
+        return renderToFile(options, source) ? 0 : 1;
+    }
+
+    if (options.delayLines) {
+        runDelayLineBenchmarks(options, source);
+        return 0;
+    }
+
+    if (options.csv) {
+        std::printf("layout,sample_rate,block_size,ns_per_sample,realtime_factor,p50_us,p99_us,max_us\n");
+    } else {
+        std::printf("%-14s %8s %6s %12s %12s %10s %10s %10s\n", "layout", "rate", "block",
+                    "ns/sample", "x realtime", "p50 us", "p99 us", "max us");
+    }
+
+    for (const auto& layout : options.layouts) {
+        for (auto sampleRate : options.sampleRates) {
+            for (auto blockSize : options.blockSizes) {
+                Result result;
+                if (!runBenchmark(options, source, layout, sampleRate, blockSize, result)) {
+                    return 1;
+                }
+
+                const char* format = options.csv
+                    ? "%s,%.0f,%d,%.3f,%.1f,%.2f,%.2f,%.2f\n"
+                    : "%-14s %8.0f %6d %12.3f %12.1f %10.2f %10.2f %10.2f\n";
+                std::printf(format, layout.name.toRawUTF8(), sampleRate, blockSize, result.nsPerSample,
+                            result.realtimeFactor, result.p50, result.p99, result.max);
+                std::fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
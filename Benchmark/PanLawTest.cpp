@@ -0,0 +1,72 @@
+#include "DSP.h"
+
+#include <cstdio>
+#include <vector>
+
+// Checks the pan law in DSP.h against the exact cos/sin law, for the scalar
+// and the block version, and that hard left and hard right are exact.
+
+static int failures = 0;
+
+static void check(bool condition, const char* what, float panning, double value)
+{
+    if (!condition) {
+        std::printf("FAILED: %s at panning %.7f (%g)\n", what, double(panning), value);
+        ++failures;
+    }
+}
+
+static void checkLaw(float panning, float left, float right)
+{
+    constexpr double tolerance = 1e-5;
+    double x = 0.25 * 3.14159265358979323846 * (double(panning) + 1.0);
+    
+    double errorL = std::abs(double(left) - std::cos(x));
+    double errorR = std::abs(double(right) - std::sin(x));
+    double power = double(left) * double(left) + double(right) * double(right);
+    
+    check(errorL < tolerance, "left differs from cos", panning, errorL);
+    check(errorR < tolerance, "right differs from sin", panning, errorR);
+    check(std::abs(power - 1.0) < tolerance, "power is not 1", panning, power);
+}
+
+int main()
+{
+    constexpr int numPositions = 100001;
+    std::vector<float> panning(numPositions), left(numPositions), right(numPositions);
+    for (int i = 0; i < numPositions; ++i) {
+        panning[size_t(i)] = -1.0f + 2.0f * float(i) / float(numPositions - 1);
+    }
+    
+    for (float p : panning) {
+        float l, r;
+        panningEqualPower(p, l, r);
+        checkLaw(p, l, r);
+    }
+    
+    panningEqualPower(panning.data(), left.data(), right.data(), numPositions);
+    for (size_t i = 0; i < panning.size(); ++i) {
+        checkLaw(panning[i], left[i], right[i]);
+    }
+    
+    // The block version may write into the panning array itself.
+    std::vector<float> inPlace = panning;
+    panningEqualPower(inPlace.data(), inPlace.data(), right.data(), numPositions);
+    for (size_t i = 0; i < panning.size(); ++i) {
+        checkLaw(panning[i], inPlace[i], right[i]);
+    }
+    
+   #if DELAY_FAST_PAN_LAW
+    // Only the polynomial gets there exactly; std::cos(pi/2) in float isn't 0.
+    float l, r;
+    panningEqualPower(-1.0f, l, r);
+    check(l == 1.0f && r == 0.0f, "hard left is not 1/0", -1.0f, double(r));
+    panningEqualPower(1.0f, l, r);
+    check(l == 0.0f && r == 1.0f, "hard right is not 0/1", 1.0f, double(l));
+   #endif
+    
+    if (failures == 0) {
+        std::printf("Pan law OK\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+#include <cstdio>
+#include <cstring>
+
+// Checks the binary plug-in state. The order of the values is written out
+// here again on purpose: a state saved by any earlier version must still
+// load, so the order in Parameters may only ever grow at the end.
+
+static const char* const expectedOrder[] = {
+    "gain", "delayTime", "mix", "feedback", "stereo", "lowCut", "highCut",
+    "tempoSync", "delayNote", "bypass", "pingPong", "delayMode", "crossfade", "trails",
+    "tap1Time", "tap1Level", "tap1Pan", "tap1Note",
+    "tap2Time", "tap2Level", "tap2Pan", "tap2Note",
+    "tap3Time", "tap3Level", "tap3Pan", "tap3Note",
+    "tap4Time", "tap4Level", "tap4Pan", "tap4Note",
+};
+
+static int failures = 0;
+
+static void check(bool condition, const juce::String& what)
+{
+    if (!condition) {
+        std::printf("FAILED: %s\n", what.toRawUTF8());
+        ++failures;
+    }
+}
+
+static float getPlainValue(const juce::RangedAudioParameter& param)
+{
+    return param.convertFrom0to1(param.getValue());
+}
+
+static void resetToDefaults(DelayAudioProcessor& processor)
+{
+    for (auto* param : processor.getParameters()) {
+        param->setValueNotifyingHost(param->getDefaultValue());
+    }
+}
+
+// Checks that the first numLoaded parameters have the given values and the
+// rest their defaults.
+static void checkValues(DelayAudioProcessor& processor, const float* values, int numLoaded,
+                        const juce::String& what)
+{
+    for (int i = 0; i < int(std::size(expectedOrder)); ++i) {
+        auto* param = processor.apvts.getParameter(expectedOrder[i]);
+        float expected = i < numLoaded ? values[i] : param->convertFrom0to1(param->getDefaultValue());
+        float tolerance = 1e-5f * std::max(1.0f, std::abs(expected));
+        check(std::abs(getPlainValue(*param) - expected) <= tolerance,
+              juce::String(expectedOrder[i]) + " is wrong after " + what);
+    }
+}
+
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    DelayAudioProcessor processor;
+    auto& apvts = processor.apvts;
+    
+    // A different value for every parameter, away from the defaults.
+    constexpr int numValues = int(std::size(expectedOrder));
+    float values[numValues];
+    for (int i = 0; i < numValues; ++i) {
+        auto* param = apvts.getParameter(expectedOrder[i]);
+        check(param != nullptr, juce::String("no parameter ") + expectedOrder[i]);
+        if (param == nullptr) { return 1; }
+        param->setValueNotifyingHost(0.1f + 0.8f * float(i) / float(numValues));
+        values[i] = getPlainValue(*param);
+    }
+    check(processor.getParameters().size() == numValues, "a parameter is missing from the state");
+    
+    juce::MemoryBlock state;
+    processor.getStateInformation(state);
+    
+    // The values follow a 12-byte header, in the expected order.
+    constexpr size_t headerSize = 3 * sizeof(std::uint32_t);
+    check(state.getSize() >= headerSize + sizeof(values), "the state is too short");
+    if (state.getSize() < headerSize + sizeof(values)) { return 1; }
+    
+    float saved[numValues];
+    std::memcpy(saved, static_cast<const char*>(state.getData()) + headerSize, sizeof(saved));
+    for (int i = 0; i < numValues; ++i) {
+        check(saved[i] == values[i], juce::String(expectedOrder[i]) + " is saved in the wrong place");
+    }
+    
+    // Change everything, then load the state back.
+    resetToDefaults(processor);
+    processor.setStateInformation(state.getData(), int(state.getSize()));
+    checkValues(processor, values, numValues, "a round trip");
+    
+    // Sessions from before the binary state saved the parameters as XML.
+    juce::MemoryBlock xmlState;
+    juce::AudioProcessor::copyXmlToBinary(*apvts.copyState().createXml(), xmlState);
+    resetToDefaults(processor);
+    processor.setStateInformation(xmlState.getData(), int(xmlState.getSize()));
+    checkValues(processor, values, numValues, "loading XML");
+    
+    // A state cut off in the middle of the sixth value: the first five load
+    // and the rest get their defaults.
+    resetToDefaults(processor);
+    processor.setStateInformation(state.getData(), int(headerSize + 5 * sizeof(float) + 2));
+    checkValues(processor, values, 5, "loading a truncated state");
+    
+    // A state from a newer version is ignored, and so is one that stops in
+    // the middle of the header.
+    juce::MemoryBlock newerState(state);
+    std::uint32_t version;
+    std::memcpy(&version, static_cast<char*>(newerState.getData()) + sizeof(std::uint32_t), sizeof(version));
+    ++version;
+    std::memcpy(static_cast<char*>(newerState.getData()) + sizeof(std::uint32_t), &version, sizeof(version));
+    resetToDefaults(processor);
+    processor.setStateInformation(newerState.getData(), int(newerState.getSize()));
+    checkValues(processor, values, 0, "loading a newer state");
+    
+    processor.setStateInformation(state.getData(), int(headerSize - 1));
+    checkValues(processor, values, 0, "loading part of a header");
+    
+    if (failures == 0) {
+        std::printf("State OK\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
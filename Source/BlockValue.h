@@ -0,0 +1,89 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// A control signal rendered for one block of audio. Most of the time a
+// parameter isn't moving, and then the block collapses to a single value:
+// `ramping` is false and the array is left alone. While the parameter ramps,
+// `values` holds one entry per sample. Either way, `value` is where the
+// control signal ends up at the end of the block.
+struct BlockValue
+{
+    void prepare(int maxBlockSize)
+    {
+        values.resize(size_t(maxBlockSize));
+    }
+
+    void setConstant(float newValue) noexcept
+    {
+        value = newValue;
+        ramping = false;
+    }
+
+    // Fill in numSamples values in the returned array, then call endRamp().
+    float* startRamp() noexcept
+    {
+        ramping = true;
+        return values.data();
+    }
+
+    void endRamp(int numSamples) noexcept
+    {
+        value = values[size_t(numSamples - 1)];
+    }
+
+    // Turns a ramp that came out flat back into a constant.
+    void collapse(int numSamples) noexcept
+    {
+        if (ramping) {
+            for (int i = 0; i < numSamples; ++i) {
+                if (values[size_t(i)] != value) { return; }
+            }
+            ramping = false;
+        }
+    }
+
+    void render(juce::LinearSmoothedValue<float>& smoother, int numSamples) noexcept
+    {
+        if (smoother.isSmoothing()) {
+            float* data = startRamp();
+            for (int i = 0; i < numSamples; ++i) {
+                data[i] = smoother.getNextValue();
+            }
+            endRamp(numSamples);
+        } else {
+            setConstant(smoother.getCurrentValue());
+        }
+    }
+
+    // The control signal at sample i of the block.
+    float at(int i) const noexcept
+    {
+        return ramping ? values[size_t(i)] : value;
+    }
+
+    // dest[i] *= value
+    void applyTo(float* dest, int numSamples) const noexcept
+    {
+        if (ramping) {
+            juce::FloatVectorOperations::multiply(dest, values.data(), numSamples);
+        } else if (value != 1.0f) {
+            juce::FloatVectorOperations::multiply(dest, value, numSamples);
+        }
+    }
+
+    // dest[i] = src[i] * value
+    void multiply(float* dest, const float* src, int numSamples) const noexcept
+    {
+        if (ramping) {
+            juce::FloatVectorOperations::multiply(dest, src, values.data(), numSamples);
+        } else {
+            juce::FloatVectorOperations::multiply(dest, src, value, numSamples);
+        }
+    }
+
+    float value = 0.0f;
+    bool ramping = false;
+    std::vector<float> values;
+};
@@ -1,10 +1,51 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 
+// Set to 0 to use std::cos and std::sin for the pan law instead of the
+// polynomial approximation below.
+#ifndef DELAY_FAST_PAN_LAW
+ #define DELAY_FAST_PAN_LAW 1
+#endif
+
+// Approximates cos(pi/2 * t) for t between 0 and 1 with an even polynomial.
+// The coefficients are a minimax fit that is exact at t = 0 and t = 1. The
+// maximum error is below 1e-5 (about -100 dB), and so is the deviation of
+// left^2 + right^2 from 1.
+inline float quarterCosine(float t) noexcept
+{
+    float u = t * t;
+    return 1.0f + u * (-1.2335215702f + u * (0.25261781654f + u * -0.019096246321f));
+}
+
 inline void panningEqualPower(float panning, float& left, float& right)
 {
+   #if DELAY_FAST_PAN_LAW
+    float t = 0.5f * (panning + 1.0f);
+    left = quarterCosine(t);
+    right = quarterCosine(1.0f - t);
+   #else
     float x = 0.7853981633974483f * (panning + 1.0f);
     left = std::cos(x);
     right = std::sin(x);
+   #endif
+}
+
+// Block version. With the fast pan law there are no function calls in the
+// loop, so the compiler can vectorize it. panning may be the same array as
+// left or right.
+inline void panningEqualPower(const float* panning, float* left, float* right, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i) {
+        panningEqualPower(panning[i], left[i], right[i]);
+    }
+}
+
+// Balance for a signal that is already stereo. In the center both channels
+// are left alone; moving off center turns down the opposite channel.
+inline void panningBalance(float panning, float& left, float& right)
+{
+    left = std::min(1.0f, 1.0f - panning);
+    right = std::min(1.0f, 1.0f + panning);
 }
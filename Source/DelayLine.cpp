@@ -1,25 +1,211 @@
 #include <JuceHeader.h>
 #include "DelayLine.h"
 
+#if JUCE_USE_SIMD
+using SIMDFloat = juce::dsp::SIMDRegister<float>;
+static constexpr size_t simdAlignment = SIMDFloat::SIMDRegisterSize;
+#else
+static constexpr size_t simdAlignment = alignof(float);
+#endif
+
+// Number of samples readBlock() gathers before running the interpolator.
+static constexpr int readChunkSize = 64;
+
+// Conversion to and from the type the ring is stored as. With compact
+// storage, samples are scaled so that +-storageRange fits in 16 bits, and
+// triangular dither of +-1 step decorrelates the rounding error from the
+// signal. The loops that call load() convert with SIMD where the compiler
+// vectorizes them.
+#if DELAY_COMPACT_STORAGE
+static constexpr float toStorageScale = 32767.0f / DelayLine::storageRange;
+static constexpr float fromStorageScale = DelayLine::storageRange / 32767.0f;
+
+static inline float load(std::int16_t sample) noexcept
+{
+    return float(sample) * fromStorageScale;
+}
+
+static inline std::int16_t store(float sample, std::uint32_t& state) noexcept
+{
+    // What would round to zero anyway is stored as silence, without dither.
+    // Otherwise the noise would go round the feedback loop forever and the
+    // tail would never die away.
+    float scaled = sample * toStorageScale;
+    if (std::abs(scaled) < 0.5f) { return 0; }
+    
+    // xorshift32, split into two uniform 16-bit numbers.
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    float dither = float(int(state >> 16) - int(state & 0xffff)) * (1.0f / 65536.0f);
+    
+    return std::int16_t(std::lrint(juce::jlimit(-32767.0f, 32767.0f, scaled + dither)));
+}
+
+static inline void storeBlock(std::int16_t* dest, const float* source, int numSamples,
+                              std::uint32_t& state) noexcept
+{
+    for (int i = 0; i < numSamples; ++i) {
+        dest[i] = store(source[i], state);
+    }
+}
+#else
+static inline float load(float sample) noexcept
+{
+    return sample;
+}
+
+static inline float store(float sample, std::uint32_t&) noexcept
+{
+    return sample;
+}
+
+static inline void storeBlock(float* dest, const float* source, int numSamples, std::uint32_t&) noexcept
+{
+    juce::FloatVectorOperations::copy(dest, source, numSamples);
+}
+#endif
+
+// Windowed-sinc kernel for readBlockBandLimited(), tabulated from 0 to
+// sincRadius samples with linear interpolation in between.
+static constexpr int sincRadius = 4;
+static constexpr int sincResolution = 512;  // table entries per sample
+
+struct SincKernel
+{
+    SincKernel()
+    {
+        constexpr double pi = juce::MathConstants<double>::pi;
+        for (int i = 0; i <= sincRadius * sincResolution; ++i) {
+            double x = double(i) / double(sincResolution);
+            double sinc = i == 0 ? 1.0 : std::sin(pi * x) / (pi * x);
+            double window = 0.42 + 0.5 * std::cos(pi * x / sincRadius)
+                                 + 0.08 * std::cos(2.0 * pi * x / sincRadius);  // Blackman
+            table[i] = float(sinc * window);
+        }
+        table[sincRadius * sincResolution + 1] = 0.0f;
+    }
+    
+    // Kernel value at x samples from the read position. Zero from
+    // sincRadius on, without a branch.
+    float operator()(float x) const noexcept
+    {
+        float position = std::min(std::abs(x), float(sincRadius)) * float(sincResolution);
+        int index = int(position);
+        float amount = position - float(index);
+        return table[index] + amount * (table[index + 1] - table[index]);
+    }
+    
+    float table[sincRadius * sincResolution + 2];
+};
+
+// Built when the plugin loads, not on the audio thread.
+static const SincKernel sincKernel;
+
+// Interpolates between taps[numTaps/2 - 1] and taps[numTaps/2], with taps
+// ordered oldest first, so fraction is how far the read position sits back
+// from the latter. stretch widens the kernel, which lowers its cutoff by the
+// same factor; the taps have to cover sincRadius * stretch on either side.
+template<typename T>
+static inline float sinc(const T* taps, int numTaps, float fraction, float stretch) noexcept
+{
+    float scale = 1.0f / stretch;
+    float offset = float(numTaps / 2) - fraction;
+    float sum = 0.0f;
+    float weightSum = 0.0f;
+    for (int tap = 0; tap < numTaps; ++tap) {
+        float weight = sincKernel((offset - float(tap)) * scale);
+        sum += load(taps[tap]) * weight;
+        weightSum += weight;
+    }
+    // Normalizing gives unity gain at DC for any fraction and stretch.
+    return sum / weightSum;
+}
+
+// 4-point Hermite interpolation between sampleB and sampleC. Written as a
+// template so read() and readBlock() share the exact same sequence of
+// operations, whether T is a float or a SIMD register.
+template<typename T>
+static inline T hermite(T sampleA, T sampleB, T sampleC, T sampleD, T fraction) noexcept
+{
+    T slope0 = (sampleC - sampleA) * 0.5f;
+    T slope1 = (sampleD - sampleB) * 0.5f;
+    T v = sampleB - sampleC;
+    T w = slope0 + v;
+    T a = w + v + slope1;
+    T b = w + a;
+    T stage1 = a * fraction - b;
+    T stage2 = stage1 * fraction + slope0;
+    return stage2 * fraction + sampleB;
+}
+
+// Wraps an index that is at most one buffer length below zero. There is no
+// branch here, so loops that call this can be vectorized.
+static inline int wrapNegative(int index, int length) noexcept
+{
+    return index + (length & (index >> 31));
+}
+
 void DelayLine::setMaximumDelayInSamples(int maxLengthInSamples)
 {
     jassert(maxLengthInSamples > 0);
     
-    int paddedLength = maxLengthInSamples + 2;
+    int paddedLength = maxLengthInSamples + paddingSamples;
     
-    if (bufferLength < paddedLength) {
+    if (bufferLength != paddedLength) {
         bufferLength = paddedLength;
-        
-        buffer.reset(new float[size_t(bufferLength)]);
+        buffer = allocateBuffer(maxLengthInSamples);
+        writeIndex = bufferLength - 1;
     }
 }
 
+void DelayLine::release() noexcept
+{
+    buffer.reset();
+    bufferLength = 0;
+    writeIndex = 0;
+}
+
+std::unique_ptr<DelayLine::Sample[]> DelayLine::allocateBuffer(int maxLengthInSamples)
+{
+    jassert(maxLengthInSamples > 0);
+    
+    size_t size = size_t(maxLengthInSamples + paddingSamples + guardSamples);
+    return std::unique_ptr<Sample[]>(new Sample[size]());
+}
+
+void DelayLine::swapBuffer(std::unique_ptr<Sample[]>& newBuffer, int maxLengthInSamples) noexcept
+{
+    int newLength = maxLengthInSamples + paddingSamples;
+    
+    // Copy over as much history as fits, oldest sample first, so that the
+    // newest one lands on the new write position. Anything older than what
+    // was kept reads as silence, which is what the zeroed buffer holds.
+    int count = std::min(bufferLength, newLength);
+    if (count > 0) {
+        int start = wrapNegative(writeIndex + 1 - count, bufferLength);
+        int firstPart = std::min(count, bufferLength - start);
+        Sample* dest = newBuffer.get();
+        std::copy_n(buffer.get() + start, firstPart, dest);
+        std::copy_n(buffer.get(), count - firstPart, dest + firstPart);
+        writeIndex = count - 1;
+    } else {
+        writeIndex = newLength - 1;
+    }
+    
+    std::swap(buffer, newBuffer);
+    bufferLength = newLength;
+    std::copy_n(buffer.get(), guardSamples, buffer.get() + bufferLength);
+}
+
 void DelayLine::reset() noexcept
 {
     writeIndex = bufferLength - 1;
     
-    for (size_t i = 0; i < size_t(bufferLength); ++i) {
-        buffer[i] = 0.0f;
+    if (buffer == nullptr) { return; }
+    
+    for (size_t i = 0; i < size_t(bufferLength + guardSamples); ++i) {
+        buffer[i] = 0;
     }
 }
 
@@ -33,47 +219,526 @@ void DelayLine::write(float input) noexcept
         writeIndex = 0;
     }
     
-    buffer[size_t(writeIndex)] = input;
+    Sample sample = store(input, ditherState);
+    buffer[size_t(writeIndex)] = sample;
+    
+    if (writeIndex < guardSamples) {
+        buffer[size_t(bufferLength + writeIndex)] = sample;
+    }
 }
 
 float DelayLine::read(float delayInSamples) const noexcept
 {
     jassert(delayInSamples >= 0.0f);
-    jassert(delayInSamples <= bufferLength - 1.0f);
+    jassert(delayInSamples <= float(bufferLength - 3));
+    
+    int integerDelay = int(delayInSamples);
+    
+    // Index of the oldest tap. Thanks to the guard samples, the other three
+    // follow it in memory even when they wrap around the end of the ring.
+    int readIndex = wrapNegative(writeIndex - integerDelay - 2, bufferLength);
+    const Sample* taps = buffer.get() + readIndex;
+    
+    float sampleD = load(taps[0]);
+    float sampleC = load(taps[1]);
+    float sampleB = load(taps[2]);
+    float sampleA = load(taps[3]);
+    
+    float fraction = delayInSamples - float(integerDelay);
+    return hermite(sampleA, sampleB, sampleC, sampleD, fraction);
+}
+
+void DelayLine::writeBlock(const float* input, int numSamples) noexcept
+{
+    jassert(bufferLength > 0);
+    jassert(numSamples >= 0 && numSamples <= bufferLength);
+    
+    if (numSamples <= 0) { return; }
+    
+    // Copy in at most two pieces: up to the end of the buffer, then whatever
+    // is left over at the start.
+    int startIndex = writeIndex + 1;
+    if (startIndex >= bufferLength) {
+        startIndex = 0;
+    }
+    
+    int firstPart = std::min(numSamples, bufferLength - startIndex);
+    storeBlock(buffer.get() + startIndex, input, firstPart, ditherState);
+    storeBlock(buffer.get(), input + firstPart, numSamples - firstPart, ditherState);
+    
+    writeIndex = startIndex + numSamples - 1;
+    if (writeIndex >= bufferLength) {
+        writeIndex -= bufferLength;
+    }
+    
+    // Refresh the guard samples if the start of the ring was written to.
+    if (startIndex < guardSamples || numSamples > firstPart) {
+        std::copy_n(buffer.get(), guardSamples, buffer.get() + bufferLength);
+    }
+}
+
+void DelayLine::readBlock(float* output, const float* delaysInSamples, int numSamples) const noexcept
+{
+    jassert(bufferLength > 0);
+    
+    alignas(simdAlignment) float samplesA[readChunkSize];
+    alignas(simdAlignment) float samplesB[readChunkSize];
+    alignas(simdAlignment) float samplesC[readChunkSize];
+    alignas(simdAlignment) float samplesD[readChunkSize];
+    alignas(simdAlignment) float fractions[readChunkSize];
+    alignas(simdAlignment) float results[readChunkSize];
+    
+    for (int start = 0; start < numSamples; start += readChunkSize) {
+        int count = std::min(readChunkSize, numSamples - start);
+        
+        // Gather the four taps for every sample of the chunk. They are always
+        // contiguous, so this loop doesn't branch.
+        for (int i = 0; i < count; ++i) {
+            int sample = start + i;
+            float delayInSamples = delaysInSamples[sample];
+            int integerDelay = int(delayInSamples);
+            
+            jassert(integerDelay >= sample + 2);
+            jassert(delayInSamples <= float(bufferLength - 3));
+            
+            int readIndex = wrapNegative(writeIndex + sample - 1 - integerDelay, bufferLength);
+            const Sample* taps = buffer.get() + readIndex;
+            
+            samplesD[i] = load(taps[0]);
+            samplesC[i] = load(taps[1]);
+            samplesB[i] = load(taps[2]);
+            samplesA[i] = load(taps[3]);
+            
+            fractions[i] = delayInSamples - float(integerDelay);
+        }
+        
+        int i = 0;
+        
+       #if JUCE_USE_SIMD
+        constexpr int vecSize = int(SIMDFloat::SIMDNumElements);
+        for (; i + vecSize <= count; i += vecSize) {
+            auto result = hermite(SIMDFloat::fromRawArray(samplesA + i),
+                                  SIMDFloat::fromRawArray(samplesB + i),
+                                  SIMDFloat::fromRawArray(samplesC + i),
+                                  SIMDFloat::fromRawArray(samplesD + i),
+                                  SIMDFloat::fromRawArray(fractions + i));
+            result.copyToRawArray(results + i);
+        }
+       #endif
+        
+        for (; i < count; ++i) {
+            results[i] = hermite(samplesA[i], samplesB[i], samplesC[i], samplesD[i], fractions[i]);
+        }
+        
+        juce::FloatVectorOperations::copy(output + start, results, count);
+    }
+}
+
+void DelayLine::readBlock(float* output, float delayInSamples, int numSamples) const noexcept
+{
+    jassert(bufferLength > 0);
     
     int integerDelay = int(delayInSamples);
     
-    int readIndexA = writeIndex - integerDelay+ 1;
-    int readIndexB = readIndexA - 1;
-    int readIndexC = readIndexA - 2;
-    int readIndexD = readIndexA - 3;
-    
-    if (readIndexA < 0) {
-        readIndexD += bufferLength;
-        if (readIndexC < 0) {
-            readIndexC += bufferLength;
-            if (readIndexB < 0) {
-                readIndexB += bufferLength;
-                if (readIndexA < 0) {
-                    readIndexA += bufferLength;
-                }
+    jassert(integerDelay >= numSamples + 1);
+    jassert(delayInSamples <= float(bufferLength - 3));
+    
+    float fraction = delayInSamples - float(integerDelay);
+    
+    // The oldest tap of sample i is at readIndex + i. The stretch only has
+    // to be split where it runs off the end of the ring; the guard samples
+    // cover the last three taps before that point.
+    int readIndex = wrapNegative(writeIndex - 1 - integerDelay, bufferLength);
+    
+    int sample = 0;
+    while (sample < numSamples) {
+        int count = std::min(numSamples - sample, bufferLength - readIndex);
+        const Sample* taps = buffer.get() + readIndex;
+        float* dest = output + sample;
+        
+        for (int i = 0; i < count; ++i) {
+            dest[i] = hermite(load(taps[i + 3]), load(taps[i + 2]), load(taps[i + 1]), load(taps[i]), fraction);
+        }
+        
+        sample += count;
+        readIndex = 0;
+    }
+}
+
+void DelayLine::readBlockBandLimited(float* output, float delayInSamples, int numSamples) const noexcept
+{
+    jassert(bufferLength > 0);
+    
+    int integerDelay = int(delayInSamples);
+    
+    jassert(integerDelay >= numSamples + sincRadius - 1);
+    jassert(delayInSamples <= float(bufferLength - sincRadius - 1));
+    
+    // The weights are the same for the entire block.
+    constexpr int numTaps = 2 * sincRadius;
+    float fraction = delayInSamples - float(integerDelay);
+    float weights[numTaps];
+    float weightSum = 0.0f;
+    for (int tap = 0; tap < numTaps; ++tap) {
+        weights[tap] = sincKernel(float(sincRadius - tap) - fraction);
+        weightSum += weights[tap];
+    }
+    for (int tap = 0; tap < numTaps; ++tap) {
+        weights[tap] /= weightSum;
+    }
+    
+    // Same as readBlock(): one contiguous stretch, split at the ring's end.
+    int readIndex = wrapNegative(writeIndex - sincRadius + 1 - integerDelay, bufferLength);
+    
+    int sample = 0;
+    while (sample < numSamples) {
+        int count = std::min(numSamples - sample, bufferLength - readIndex);
+        const Sample* taps = buffer.get() + readIndex;
+        float* dest = output + sample;
+        
+        for (int i = 0; i < count; ++i) {
+            float sum = 0.0f;
+            for (int tap = 0; tap < numTaps; ++tap) {
+                sum += load(taps[i + tap]) * weights[tap];
             }
+            dest[i] = sum;
         }
+        
+        sample += count;
+        readIndex = 0;
     }
+}
+
+void DelayLine::readBlockBandLimited(float* output, const float* delaysInSamples, float previousDelay,
+                                     int numSamples, int oversampling) const noexcept
+{
+    jassert(bufferLength > 0);
+    jassert(oversampling >= 1 && oversampling <= maxOversampling);
     
-    float sampleA = buffer[size_t(readIndexA)];
-    float sampleB = buffer[size_t(readIndexB)];
-    float sampleC = buffer[size_t(readIndexC)];
-    float sampleD = buffer[size_t(readIndexD)];
+    int radius = sincRadius * oversampling;
+    int numTaps = 2 * radius;
+    
+    for (int sample = 0; sample < numSamples; ++sample) {
+        float delayInSamples = delaysInSamples[sample];
+        int integerDelay = int(delayInSamples);
+        
+        jassert(integerDelay >= sample + radius);
+        jassert(delayInSamples <= float(bufferLength - radius - 1));
+        
+        // How far the head travelled since the previous sample. Above normal
+        // speed, the kernel is widened by the same factor so its cutoff drops
+        // below the new Nyquist frequency.
+        float speed = 1.0f + previousDelay - delayInSamples;
+        float stretch = juce::jlimit(1.0f, float(oversampling), speed);
+        previousDelay = delayInSamples;
+        
+        int readIndex = wrapNegative(writeIndex + sample + 1 - radius - integerDelay, bufferLength);
+        float fraction = delayInSamples - float(integerDelay);
+        output[sample] = sinc(buffer.get() + readIndex, numTaps, fraction, stretch);
+    }
+}
+
+void DelayLine::addTaps(float* output, const Tap* taps, int numTaps, int numSamples) const noexcept
+{
+    jassert(bufferLength > 0);
+    
+    for (int i = 0; i < numTaps; ++i) {
+        const Tap& tap = taps[i];
+        if (tap.gain == 0.0f && tap.gainIncrement == 0.0f) {
+            continue;
+        }
+        if (tap.delayIncrement == 0.0f) {
+            addFixedTap(output, tap, numSamples);
+        } else {
+            addMovingTap(output, tap, numSamples);
+        }
+    }
+}
+
+void DelayLine::addFixedTap(float* output, const Tap& tap, int numSamples) const noexcept
+{
+    int integerDelay = int(tap.delayInSamples);
+    
+    jassert(integerDelay >= numSamples + 1);
+    jassert(tap.delayInSamples <= float(bufferLength - 3));
+    
+    // hermite() written out as one weight per sample. They only depend on the
+    // fraction, which is the same for the entire block.
+    float t = tap.delayInSamples - float(integerDelay);
+    float t2 = t * t;
+    float t3 = t2 * t;
+    float weightA = 0.5f * (-t3 + 2.0f * t2 - t);
+    float weightB = 0.5f * (3.0f * t3 - 5.0f * t2) + 1.0f;
+    float weightC = 0.5f * (-3.0f * t3 + 4.0f * t2 + t);
+    float weightD = 0.5f * (t3 - t2);
+    
+    int readIndex = wrapNegative(writeIndex - 1 - integerDelay, bufferLength);
+    float gain = tap.gain;
+    
+    int sample = 0;
+    while (sample < numSamples) {
+        int count = std::min(numSamples - sample, bufferLength - readIndex);
+        const Sample* taps = buffer.get() + readIndex;
+        float* dest = output + sample;
+        
+        if (tap.gainIncrement == 0.0f) {
+            float a = weightA * gain;
+            float b = weightB * gain;
+            float c = weightC * gain;
+            float d = weightD * gain;
+            for (int i = 0; i < count; ++i) {
+                dest[i] += d * load(taps[i]) + c * load(taps[i + 1])
+                         + b * load(taps[i + 2]) + a * load(taps[i + 3]);
+            }
+        } else {
+            for (int i = 0; i < count; ++i) {
+                float g = gain + float(i) * tap.gainIncrement;
+                dest[i] += g * (weightD * load(taps[i]) + weightC * load(taps[i + 1])
+                              + weightB * load(taps[i + 2]) + weightA * load(taps[i + 3]));
+            }
+            gain += float(count) * tap.gainIncrement;
+        }
+        
+        sample += count;
+        readIndex = 0;
+    }
+}
+
+void DelayLine::addMovingTap(float* output, const Tap& tap, int numSamples) const noexcept
+{
+    for (int sample = 0; sample < numSamples; ++sample) {
+        float delayInSamples = tap.delayInSamples + float(sample) * tap.delayIncrement;
+        int integerDelay = int(delayInSamples);
+        
+        jassert(integerDelay >= sample + 2);
+        jassert(delayInSamples <= float(bufferLength - 3));
+        
+        int readIndex = wrapNegative(writeIndex + sample - 1 - integerDelay, bufferLength);
+        const Sample* taps = buffer.get() + readIndex;
+        
+        float fraction = delayInSamples - float(integerDelay);
+        float gain = tap.gain + float(sample) * tap.gainIncrement;
+        output[sample] += gain * hermite(load(taps[3]), load(taps[2]), load(taps[1]), load(taps[0]), fraction);
+    }
+}
+
+template<int numChannels>
+void InterleavedDelayLine<numChannels>::setMaximumDelayInSamples(int maxLengthInSamples)
+{
+    jassert(maxLengthInSamples > 0);
+    
+    int paddedLength = maxLengthInSamples + 3;
+    
+    if (bufferLength != paddedLength) {
+        bufferLength = paddedLength;
+        buffer.reset(new float[size_t((bufferLength + guardFrames) * numChannels)]());
+        writeIndex = bufferLength - 1;
+    }
+}
+
+template<int numChannels>
+void InterleavedDelayLine<numChannels>::reset() noexcept
+{
+    writeIndex = bufferLength - 1;
+    
+    if (buffer == nullptr) { return; }
+    
+    juce::FloatVectorOperations::clear(buffer.get(), (bufferLength + guardFrames) * numChannels);
+}
+
+template<int numChannels>
+void InterleavedDelayLine<numChannels>::write(const float* frame) noexcept
+{
+    jassert(bufferLength > 0);
+    
+    writeIndex += 1;
+    
+    if (writeIndex >= bufferLength) {
+        writeIndex = 0;
+    }
+    
+    float* dest = buffer.get() + writeIndex * numChannels;
+    for (int channel = 0; channel < numChannels; ++channel) {
+        dest[channel] = frame[channel];
+    }
+    
+    if (writeIndex < guardFrames) {
+        float* guard = buffer.get() + (bufferLength + writeIndex) * numChannels;
+        for (int channel = 0; channel < numChannels; ++channel) {
+            guard[channel] = frame[channel];
+        }
+    }
+}
+
+template<int numChannels>
+void InterleavedDelayLine<numChannels>::read(float delayInSamples, float* frame) const noexcept
+{
+    jassert(delayInSamples >= 0.0f);
+    jassert(delayInSamples <= float(bufferLength - 3));
+    
+    int integerDelay = int(delayInSamples);
+    int readIndex = wrapNegative(writeIndex - integerDelay - 2, bufferLength);
+    const float* taps = buffer.get() + readIndex * numChannels;
     
     float fraction = delayInSamples - float(integerDelay);
-    float slope0 = (sampleC - sampleA) * 0.5f;
-    float slope1 = (sampleD - sampleB) * 0.5f;
-    float v = sampleB - sampleC;
-    float w = slope0 + v;
-    float a = w + v + slope1;
-    float b = w + a;
-    float stage1 = a * fraction - b;
-    float stage2 = stage1 * fraction + slope0;
-    return stage2 * fraction + sampleB;
+    for (int channel = 0; channel < numChannels; ++channel) {
+        frame[channel] = hermite(taps[channel + 3 * numChannels], taps[channel + 2 * numChannels],
+                                 taps[channel + numChannels], taps[channel], fraction);
+    }
+}
+
+template<int numChannels>
+void InterleavedDelayLine<numChannels>::writeBlock(const float* const* input, int numSamples) noexcept
+{
+    jassert(bufferLength > 0);
+    jassert(numSamples >= 0 && numSamples <= bufferLength);
+    
+    if (numSamples <= 0) { return; }
+    
+    int startIndex = writeIndex + 1;
+    if (startIndex >= bufferLength) {
+        startIndex = 0;
+    }
+    
+    // Interleave in at most two pieces, like DelayLine::writeBlock().
+    int sample = 0;
+    int index = startIndex;
+    while (sample < numSamples) {
+        int count = std::min(numSamples - sample, bufferLength - index);
+        float* dest = buffer.get() + index * numChannels;
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const float* source = input[channel] + sample;
+            for (int i = 0; i < count; ++i) {
+                dest[i * numChannels + channel] = source[i];
+            }
+        }
+        sample += count;
+        index = 0;
+    }
+    
+    writeIndex = startIndex + numSamples - 1;
+    if (writeIndex >= bufferLength) {
+        writeIndex -= bufferLength;
+    }
+    
+    if (startIndex < guardFrames || startIndex + numSamples > bufferLength) {
+        juce::FloatVectorOperations::copy(buffer.get() + bufferLength * numChannels, buffer.get(),
+                                          guardFrames * numChannels);
+    }
+}
+
+template<int numChannels>
+void InterleavedDelayLine<numChannels>::readBlock(float* const* output, const float* delaysInSamples,
+                                                  int numSamples) const noexcept
+{
+    jassert(bufferLength > 0);
+    
+    // Same as DelayLine::readBlock(), except that every gathered tap is a
+    // whole frame. The Hermite step then runs over all channels of the chunk
+    // at once, and only the results are split up into the channels.
+    constexpr int chunkSize = readChunkSize * numChannels;
+    alignas(simdAlignment) float samplesA[chunkSize];
+    alignas(simdAlignment) float samplesB[chunkSize];
+    alignas(simdAlignment) float samplesC[chunkSize];
+    alignas(simdAlignment) float samplesD[chunkSize];
+    alignas(simdAlignment) float fractions[chunkSize];
+    alignas(simdAlignment) float results[chunkSize];
+    
+    for (int start = 0; start < numSamples; start += readChunkSize) {
+        int count = std::min(readChunkSize, numSamples - start);
+        
+        for (int i = 0; i < count; ++i) {
+            int sample = start + i;
+            float delayInSamples = delaysInSamples[sample];
+            int integerDelay = int(delayInSamples);
+            
+            jassert(integerDelay >= sample + 2);
+            jassert(delayInSamples <= float(bufferLength - 3));
+            
+            int readIndex = wrapNegative(writeIndex + sample - 1 - integerDelay, bufferLength);
+            const float* taps = buffer.get() + readIndex * numChannels;
+            float fraction = delayInSamples - float(integerDelay);
+            
+            for (int channel = 0; channel < numChannels; ++channel) {
+                int j = i * numChannels + channel;
+                samplesD[j] = taps[channel];
+                samplesC[j] = taps[channel + numChannels];
+                samplesB[j] = taps[channel + 2 * numChannels];
+                samplesA[j] = taps[channel + 3 * numChannels];
+                fractions[j] = fraction;
+            }
+        }
+        
+        int total = count * numChannels;
+        int j = 0;
+        
+       #if JUCE_USE_SIMD
+        constexpr int vecSize = int(SIMDFloat::SIMDNumElements);
+        for (; j + vecSize <= total; j += vecSize) {
+            auto result = hermite(SIMDFloat::fromRawArray(samplesA + j),
+                                  SIMDFloat::fromRawArray(samplesB + j),
+                                  SIMDFloat::fromRawArray(samplesC + j),
+                                  SIMDFloat::fromRawArray(samplesD + j),
+                                  SIMDFloat::fromRawArray(fractions + j));
+            result.copyToRawArray(results + j);
+        }
+       #endif
+        
+        for (; j < total; ++j) {
+            results[j] = hermite(samplesA[j], samplesB[j], samplesC[j], samplesD[j], fractions[j]);
+        }
+        
+        for (int channel = 0; channel < numChannels; ++channel) {
+            float* dest = output[channel] + start;
+            for (int i = 0; i < count; ++i) {
+                dest[i] = results[i * numChannels + channel];
+            }
+        }
+    }
 }
+
+template<int numChannels>
+void InterleavedDelayLine<numChannels>::readBlock(float* const* output, float delayInSamples,
+                                                  int numSamples) const noexcept
+{
+    jassert(bufferLength > 0);
+    
+    int integerDelay = int(delayInSamples);
+    
+    jassert(integerDelay >= numSamples + 1);
+    jassert(delayInSamples <= float(bufferLength - 3));
+    
+    float fraction = delayInSamples - float(integerDelay);
+    
+    // The frames form one contiguous stretch of the ring, so the taps of all
+    // channels are one run of floats, numChannels apart per tap.
+    alignas(simdAlignment) float results[readChunkSize * numChannels];
+    
+    int readIndex = wrapNegative(writeIndex - 1 - integerDelay, bufferLength);
+    
+    int sample = 0;
+    while (sample < numSamples) {
+        int count = std::min({ numSamples - sample, bufferLength - readIndex, readChunkSize });
+        const float* taps = buffer.get() + readIndex * numChannels;
+        
+        for (int j = 0; j < count * numChannels; ++j) {
+            results[j] = hermite(taps[j + 3 * numChannels], taps[j + 2 * numChannels],
+                                 taps[j + numChannels], taps[j], fraction);
+        }
+        
+        for (int channel = 0; channel < numChannels; ++channel) {
+            float* dest = output[channel] + sample;
+            for (int i = 0; i < count; ++i) {
+                dest[i] = results[i * numChannels + channel];
+            }
+        }
+        
+        sample += count;
+        readIndex += count;
+        if (readIndex >= bufferLength) {
+            readIndex = 0;
+        }
+    }
+}
+
+template class InterleavedDelayLine<2>;
@@ -1,23 +1,174 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
+// Set to 1 to store the delay lines as dithered 16-bit integers instead of
+// floats. That halves their memory and the bandwidth of every read, at a
+// noise floor of about -84 dB below 1.0 (the range is +-4, or +12 dB, and
+// louder samples are clipped). The interleaved delay line always uses
+// floats.
+#ifndef DELAY_COMPACT_STORAGE
+ #define DELAY_COMPACT_STORAGE 0
+#endif
+
 class DelayLine
 {
 public:
+    // What the ring holds. Samples quieter than silenceLevel are stored as
+    // exact zeros.
+   #if DELAY_COMPACT_STORAGE
+    using Sample = std::int16_t;
+    static constexpr float storageRange = 4.0f;
+    static constexpr float silenceLevel = 0.5f * storageRange / 32767.0f;
+   #else
+    using Sample = float;
+    static constexpr float silenceLevel = 0.0f;
+   #endif
+    
+    // Allocates, so don't call this from the audio thread. Use swapBuffer()
+    // to resize a delay line that is running.
     void setMaximumDelayInSamples(int maxLengthInSamples);
     
+    int getMaximumDelayInSamples() const noexcept
+    {
+        return bufferLength > 0 ? bufferLength - paddingSamples : 0;
+    }
+    
     void reset() noexcept;
     
+    // Frees the buffer.
+    void release() noexcept;
+    
+    // Resizing while the audio is running: allocateBuffer() prepares a zeroed
+    // buffer away from the audio thread, and swapBuffer() moves the most
+    // recent samples into it on the audio thread. Afterwards newBuffer holds
+    // the old buffer, so it can be freed away from the audio thread too.
+    static std::unique_ptr<Sample[]> allocateBuffer(int maxLengthInSamples);
+    void swapBuffer(std::unique_ptr<Sample[]>& newBuffer, int maxLengthInSamples) noexcept;
+    
     void write(float input) noexcept;
     float read(float delayInSamples) const noexcept;
     
+    // Block versions of write() and read(). readBlock() looks ahead: it must
+    // be called *before* writeBlock() for the same stretch of samples, and
+    // output[i] is what read(delaysInSamples[i]) would return right after the
+    // i-th of those writes. That lets the feedback path read a whole segment
+    // before its input is known, as long as every delay is at least
+    // numSamples + 1 so no tap reaches into the samples not yet written.
+    //
+    // The Hermite interpolation is done with SIMD registers. It performs the
+    // same operations in the same order as read(), so the results are
+    // identical unless the compiler fuses the scalar version's multiply-adds,
+    // in which case they differ by a few ulp (well below 1e-6 for signals in
+    // the range -1 to 1).
+    void writeBlock(const float* input, int numSamples) noexcept;
+    void readBlock(float* output, const float* delaysInSamples, int numSamples) const noexcept;
+    
+    // Same as above for a delay that doesn't change during the block. The
+    // taps then form one contiguous stretch of the ring, so there is no
+    // gather step at all.
+    void readBlock(float* output, float delayInSamples, int numSamples) const noexcept;
+    
+    // Band-limited versions of readBlock() for repitch mode. They use an
+    // 8-point windowed-sinc interpolator instead of the Hermite curve.
+    //
+    // When the head moves faster than normal speed, the signal has to be
+    // low-passed before it is read or it aliases. With oversampling at 2 or
+    // 4, the kernel is widened (up to that factor) to follow the head speed,
+    // which lowers its cutoff to match. That's the decimation filter of a 2x
+    // or 4x oversampled read folded into the interpolator, and it takes 2 or
+    // 4 times as many taps. previousDelay is the delay of the sample before
+    // delaysInSamples[0], to tell the speed.
+    //
+    // The kernel reaches 4 * oversampling samples ahead of the delay, so every
+    // delay must be at least numSamples + 4 * oversampling.
+    void readBlockBandLimited(float* output, float delayInSamples, int numSamples) const noexcept;
+    void readBlockBandLimited(float* output, const float* delaysInSamples, float previousDelay,
+                              int numSamples, int oversampling) const noexcept;
+    
+    static constexpr int maxOversampling = 4;
+    
+    // One read position of the multi-tap engine. Over the block, the delay
+    // and the gain move linearly by the given amount per sample.
+    struct Tap
+    {
+        float delayInSamples = 0.0f;
+        float delayIncrement = 0.0f;
+        float gain = 0.0f;
+        float gainIncrement = 0.0f;
+    };
+    
+    // Mixes a number of taps into output: output[i] += gain * read(delay),
+    // looking ahead the same way as readBlock(). However many taps there are,
+    // the input is only written once. For a tap whose delay holds still, the
+    // gain is folded into the four interpolation weights, so it costs four
+    // multiply-adds per sample over contiguous memory and no scratch space.
+    void addTaps(float* output, const Tap* taps, int numTaps, int numSamples) const noexcept;
+    
     int getBufferLength() const noexcept
     {
         return bufferLength;
     }
 private:
-    std::unique_ptr<float[]> buffer;
+    void addFixedTap(float* output, const Tap& tap, int numSamples) const noexcept;
+    void addMovingTap(float* output, const Tap& tap, int numSamples) const noexcept;
+    
+    // The Hermite taps span four consecutive samples, the widest sinc kernel
+    // 32. The buffer has this many extra samples past its end that mirror
+    // the first ones, so the taps are always contiguous in memory and reads
+    // never wrap.
+    static constexpr int guardSamples = 8 * maxOversampling - 1;
+    
+    // The oldest tap of the widest sinc kernel sits 4 * maxOversampling
+    // samples beyond the integer delay, and the sample at the write position
+    // is about to be overwritten.
+    static constexpr int paddingSamples = 4 * maxOversampling + 1;
+    
+    std::unique_ptr<Sample[]> buffer;
     int bufferLength = 0;
     int writeIndex = 0;  // Where the most recent value was written
+    std::uint32_t ditherState = 0x9e3779b9;  // only used by compact storage
+};
+
+// A delay line for several channels that share the same delay. The ring
+// stores whole frames, L R L R and so on for stereo, so writing a frame is
+// one store and the four Hermite taps of every channel sit together in one
+// or two cache lines instead of in separate buffers. The results are the
+// same as one DelayLine per channel.
+//
+// Only the Hermite reads are here. The lookahead rules are the same as for
+// DelayLine::readBlock(). Explicitly instantiated in DelayLine.cpp for
+// numChannels = 2; add more there when needed.
+template<int numChannels>
+class InterleavedDelayLine
+{
+public:
+    // Allocates, so don't call this from the audio thread.
+    void setMaximumDelayInSamples(int maxLengthInSamples);
+    
+    void reset() noexcept;
+    
+    // frame holds one sample for every channel.
+    void write(const float* frame) noexcept;
+    void read(float delayInSamples, float* frame) const noexcept;
+    
+    // input and output hold numChannels pointers to separate channels, like
+    // juce::AudioBuffer.
+    void writeBlock(const float* const* input, int numSamples) noexcept;
+    void readBlock(float* const* output, const float* delaysInSamples, int numSamples) const noexcept;
+    void readBlock(float* const* output, float delayInSamples, int numSamples) const noexcept;
+    
+    int getBufferLength() const noexcept
+    {
+        return bufferLength;
+    }
+private:
+    // Past the end of the ring, copies of the first three frames, so the
+    // taps never wrap.
+    static constexpr int guardFrames = 3;
+    
+    std::unique_ptr<float[]> buffer;
+    int bufferLength = 0;  // in frames
+    int writeIndex = 0;    // frame that was written last
 };
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LockFreeFifo.h"
+#include "Parameters.h"
+
+// What the editor needs to show the contents of the delay line. The audio
+// thread boils everything that's written into the delay lines down to one
+// min/max pair per samplesPerColumn samples, and passes those on through a
+// FIFO. It also publishes the settings the display draws its tap markers
+// and decay curve from. Only the audio thread writes, only the editor reads.
+class DelayScope
+{
+public:
+    static constexpr int samplesPerColumn = 256;
+
+    struct Column
+    {
+        float min = 0.0f;
+        float max = 0.0f;
+    };
+
+    // About 5 seconds at 48 kHz, so a slow editor doesn't lose any.
+    LockFreeFifo<Column, 1024> columns;
+
+    std::atomic<float> sampleRate { 44100.0f };
+    std::atomic<float> delayTime { 0.0f };  // milliseconds
+    std::array<std::atomic<float>, Parameters::numTaps> tapTimes {};  // 0 when off
+    std::atomic<float> feedback { 0.0f };   // -1 to 1
+    std::atomic<float> lowCut { 20.0f };    // Hz
+    std::atomic<float> highCut { 20000.0f };
+
+    void reset() noexcept
+    {
+        count = 0;
+    }
+
+    // right may be the same as left.
+    void write(const float* left, const float* right, int numSamples) noexcept
+    {
+        while (numSamples > 0) {
+            int n = std::min(numSamples, samplesPerColumn - count);
+            auto range = juce::FloatVectorOperations::findMinAndMax(left, n);
+            if (right != left) {
+                range = range.getUnionWith(juce::FloatVectorOperations::findMinAndMax(right, n));
+            }
+            add(range.getStart(), range.getEnd(), n);
+            left += n;
+            right += n;
+            numSamples -= n;
+        }
+    }
+
+    // While the processor is idle, the delay lines are empty.
+    void writeSilence(int numSamples) noexcept
+    {
+        while (numSamples > 0) {
+            int n = std::min(numSamples, samplesPerColumn - count);
+            add(0.0f, 0.0f, n);
+            numSamples -= n;
+        }
+    }
+
+private:
+    void add(float min, float max, int numSamples) noexcept
+    {
+        if (count == 0) {
+            current = { min, max };
+        } else {
+            current.min = std::min(current.min, min);
+            current.max = std::max(current.max, max);
+        }
+        count += numSamples;
+        if (count == samplesPerColumn) {
+            columns.push(current);
+            count = 0;
+        }
+    }
+
+    Column current;
+    int count = 0;
+};
@@ -0,0 +1,191 @@
+#include <JuceHeader.h>
+#include "DelayScopeView.h"
+#include "LookAndFeel.h"
+
+DelayScopeView::DelayScopeView(DelayScope& scope_)
+    : RefreshClient(static_cast<juce::Component&>(*this)),
+      scope(scope_)
+{
+    // Whatever is in there is from before the editor was opened.
+    scope.columns.clear();
+
+    setOpaque(true);
+    startRefreshHz(refreshRate);
+}
+
+DelayScopeView::~DelayScopeView()
+{
+}
+
+void DelayScopeView::paint(juce::Graphics& g)
+{
+    g.fillAll(Colors::Scope::background);
+
+    float width = float(getWidth());
+    float height = float(getHeight());
+    float centerY = height * 0.5f;
+
+    g.setColour(Colors::Scope::axis);
+    g.fillRect(0.0f, centerY - 0.5f, width, 1.0f);
+
+    // The newest column ends at the right edge.
+    float columnWidth = width / float(visibleColumns);
+    auto firstVisible = numColumns - visibleColumns;
+    g.setColour(Colors::Scope::waveform);
+    g.fillPath(waveform, juce::AffineTransform::translation(float(waveformStart - firstVisible), 0.0f)
+                                               .scaled(columnWidth, centerY)
+                                               .translated(0.0f, centerY));
+
+    g.setColour(Colors::Scope::decay);
+    g.strokePath(decayCurve, juce::PathStrokeType(1.0f));
+
+    g.setColour(Colors::Scope::tapMarker);
+    for (float tapTime : tapTimes) {
+        if (tapTime > 0.0f) {
+            g.fillRect(xForAge(tapTime), 0.0f, 1.0f, height);
+        }
+    }
+    g.setColour(Colors::Scope::delayMarker);
+    g.fillRect(xForAge(delayTime), 0.0f, 1.0f, height);
+}
+
+void DelayScopeView::resized()
+{
+    updateLayout();
+}
+
+void DelayScopeView::refresh()
+{
+    bool changed = readSettings();
+    if (changed) {
+        updateLayout();
+    }
+
+    bool received = false;
+    DelayScope::Column column;
+    while (scope.columns.pop(column)) {
+        history[size_t(numColumns % historySize)] = column;
+        if (column.min != 0.0f || column.max != 0.0f) {
+            lastSound = numColumns + 1;
+        }
+        appendColumn(numColumns++);
+        received = true;
+    }
+
+    if (numColumns - waveformStart > 2 * visibleColumns) {
+        rebuildWaveform();
+    }
+
+    // Once everything on screen is silence, there's nothing left to scroll.
+    bool nowQuiet = numColumns - lastSound > visibleColumns;
+    if (changed || (received && !(quiet && nowQuiet))) {
+        repaint();
+    }
+    quiet = nowQuiet;
+}
+
+bool DelayScopeView::readSettings()
+{
+    bool changed = false;
+    auto read = [&changed](const std::atomic<float>& source, float& value)
+    {
+        float newValue = source.load(std::memory_order_relaxed);
+        if (newValue != value) {
+            value = newValue;
+            changed = true;
+        }
+    };
+
+    read(scope.sampleRate, sampleRate);
+    read(scope.delayTime, delayTime);
+    for (size_t i = 0; i < tapTimes.size(); ++i) {
+        read(scope.tapTimes[i], tapTimes[i]);
+    }
+    read(scope.feedback, feedback);
+    read(scope.lowCut, lowCut);
+    read(scope.highCut, highCut);
+    return changed;
+}
+
+// Twice the longest delay in use, so that the first repeat is on screen too.
+void DelayScopeView::updateLayout()
+{
+    float longest = delayTime;
+    for (float tapTime : tapTimes) {
+        longest = std::max(longest, tapTime);
+    }
+    windowLength = juce::jlimit(minWindowLength, maxWindowLength, 2.0f * longest);
+
+    float columnsPerMs = sampleRate / (1000.0f * float(DelayScope::samplesPerColumn));
+    visibleColumns = juce::jlimit(1, historySize, int(std::ceil(windowLength * columnsPerMs)));
+
+    // Silence still shows up as a line, one pixel high.
+    minColumnHeight = 2.0f / float(std::max(1, getHeight()));
+
+    rebuildWaveform();
+    buildDecayCurve();
+}
+
+void DelayScopeView::rebuildWaveform()
+{
+    waveform.clear();
+    waveformStart = std::max(juce::int64(0), numColumns - visibleColumns);
+    for (auto i = waveformStart; i < numColumns; ++i) {
+        appendColumn(i);
+    }
+}
+
+void DelayScopeView::appendColumn(juce::int64 index)
+{
+    const auto& column = history[size_t(index % historySize)];
+    float top = -juce::jlimit(-1.0f, 1.0f, column.max);
+    float bottom = -juce::jlimit(-1.0f, 1.0f, column.min);
+    if (bottom - top < minColumnHeight) {
+        float center = (top + bottom) * 0.5f;
+        top = center - minColumnHeight * 0.5f;
+        bottom = center + minColumnHeight * 0.5f;
+    }
+    waveform.addRectangle(float(index - waveformStart), top, 1.0f, bottom - top);
+}
+
+// How loud a full-scale sound is after it has gone round the feedback loop
+// for a while, with a dot at every repeat. The filters are 12 dB/octave, and
+// this takes their gain at the center of the band that's let through, so
+// it's an estimate.
+void DelayScopeView::buildDecayCurve()
+{
+    decayCurve.clear();
+    if (delayTime <= 0.0f || feedback == 0.0f || getWidth() <= 0) { return; }
+
+    float center = std::sqrt(lowCut * highCut);
+    float lowCutGain = 1.0f / std::sqrt(1.0f + std::pow(lowCut / center, 4.0f));
+    float highCutGain = 1.0f / std::sqrt(1.0f + std::pow(center / highCut, 4.0f));
+    float gain = std::abs(feedback) * lowCutGain * highCutGain;
+
+    float centerY = float(getHeight()) * 0.5f;
+    auto levelAt = [this, gain](float age)
+    {
+        return std::pow(gain, age / delayTime);
+    };
+
+    for (float sign : { -1.0f, 1.0f }) {
+        decayCurve.startNewSubPath(xForAge(0.0f), centerY + sign * centerY);
+        for (int x = getWidth() - 2; x >= -2; x -= 2) {
+            float age = (float(getWidth()) - float(x)) / float(getWidth()) * windowLength;
+            decayCurve.lineTo(float(x), centerY + sign * centerY * levelAt(age));
+        }
+    }
+
+    // Short delays leave no room between the dots.
+    if (float(getWidth()) * delayTime / windowLength < 4.0f) { return; }
+
+    for (float age = delayTime; age <= windowLength; age += delayTime) {
+        float y = centerY - centerY * levelAt(age);
+        decayCurve.addEllipse(xForAge(age) - 1.5f, y - 1.5f, 3.0f, 3.0f);
+    }
+}
+
+float DelayScopeView::xForAge(float ms) const noexcept
+{
+    return float(getWidth()) * (1.0f - ms / windowLength);
+}
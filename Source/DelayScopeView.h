@@ -0,0 +1,65 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayScope.h"
+#include "RefreshScheduler.h"
+
+// Shows what's in the delay line: the most recent stretch of everything that
+// was written into it, scrolling from right to left, with a marker for the
+// delay time and every tap that is turned up, and the curve an echo decays
+// along with the current feedback and filter settings.
+class DelayScopeView : public juce::Component, private RefreshClient
+{
+public:
+    DelayScopeView(DelayScope& scope);
+    ~DelayScopeView() override;
+
+    void paint(juce::Graphics&) override;
+    void resized() override;
+
+private:
+    void refresh() override;
+    bool readSettings();
+    void updateLayout();
+    void rebuildWaveform();
+    void appendColumn(juce::int64 index);
+    void buildDecayCurve();
+    float xForAge(float ms) const noexcept;
+
+    DelayScope& scope;
+
+    // The columns received so far, of which the last historySize are kept
+    // around for when the waveform has to be built from scratch. That's 5
+    // seconds at 192 kHz.
+    static constexpr int historySize = 4096;
+    std::array<DelayScope::Column, historySize> history;
+    juce::int64 numColumns = 0;
+    juce::int64 lastSound = 0;  // the column after the last one that wasn't silent
+
+    // The waveform in column units, one rectangle per column. New columns
+    // are added at the end and paint() slides the whole path to the left,
+    // so it's only built again every visibleColumns columns, when the part
+    // that has scrolled out of view gets as long as the part that's shown.
+    juce::Path waveform;
+    juce::int64 waveformStart = 0;  // the column at x = 0 in the path
+    int visibleColumns = 1;
+    float minColumnHeight = 0.0f;
+
+    // The settings it was last drawn with.
+    float sampleRate = 0.0f;
+    float delayTime = 0.0f;
+    std::array<float, Parameters::numTaps> tapTimes {};
+    float feedback = 0.0f;
+    float lowCut = 0.0f;
+    float highCut = 0.0f;
+
+    float windowLength = 1000.0f;  // milliseconds
+    juce::Path decayCurve;
+    bool quiet = false;
+
+    static constexpr int refreshRate = 30;
+    static constexpr float minWindowLength = 250.0f;
+    static constexpr float maxWindowLength = 5000.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DelayScopeView)
+};
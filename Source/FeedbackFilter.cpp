@@ -0,0 +1,46 @@
+#include "FeedbackFilter.h"
+
+void FeedbackFilter::prepare(double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate;
+    
+    // Butterworth response, same default as StateVariableTPTFilter.
+    float resonance = float(1.0 / juce::MathConstants<double>::sqrt2);
+    R2 = float(1.0 / resonance);
+    
+    lastLowCut = -1.0f;
+    lastHighCut = -1.0f;
+}
+
+void FeedbackFilter::reset() noexcept
+{
+    for (int lane = 0; lane < numLanes; ++lane) {
+        lowS1[lane] = 0.0f;
+        lowS2[lane] = 0.0f;
+        highS1[lane] = 0.0f;
+        highS2[lane] = 0.0f;
+    }
+}
+
+void FeedbackFilter::setCutoffs(float lowCut, float highCut) noexcept
+{
+    if (lowCut != lastLowCut) {
+        calculateCoefficients(lowCut, lowG, lowH, lowGR);
+        lastLowCut = lowCut;
+    }
+    if (highCut != lastHighCut) {
+        calculateCoefficients(highCut, highG, highH, highGR);
+        lastHighCut = highCut;
+    }
+}
+
+void FeedbackFilter::calculateCoefficients(float cutoff, float& g, float& h, float& gr) const noexcept
+{
+    // Above Nyquist the tan() blows up, which can happen at low sample rates
+    // with the high cut at its default of 20 kHz.
+    cutoff = std::min(cutoff, float(sampleRate * 0.49));
+    
+    g = float(std::tan(juce::MathConstants<double>::pi * cutoff / sampleRate));
+    h = float(1.0 / (1.0 + R2 * g + g * g));
+    gr = g + R2;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// The low-cut and high-cut filters of the feedback path, fused into a single
+// band-pass stage. Both are TPT state variable filters, the same design as
+// juce::dsp::StateVariableTPTFilter, but every channel gets its own lane.
+// Each step of the filter is a short loop over the lanes, which the compiler
+// turns into one SIMD instruction, so L and R (or up to numLanes taps) are
+// filtered for the price of one.
+class FeedbackFilter
+{
+public:
+    static constexpr int numLanes = 4;
+    
+    void prepare(double sampleRate) noexcept;
+    void reset() noexcept;
+    
+    // Recalculates the coefficients, but only if a cutoff actually changed.
+    void setCutoffs(float lowCut, float highCut) noexcept;
+    
+    // Filters one sample of every lane, in place.
+    void process(float* frame) noexcept
+    {
+        for (int lane = 0; lane < numLanes; ++lane) {
+            float x = frame[lane];
+            
+            // High-pass (low cut)
+            float hp = lowH * (x - lowS1[lane] * lowGR - lowS2[lane]);
+            float bp = hp * lowG + lowS1[lane];
+            lowS1[lane] = hp * lowG + bp;
+            float lp = bp * lowG + lowS2[lane];
+            lowS2[lane] = bp * lowG + lp;
+            
+            // Low-pass (high cut), fed by the high-pass output
+            float hp2 = highH * (hp - highS1[lane] * highGR - highS2[lane]);
+            float bp2 = hp2 * highG + highS1[lane];
+            highS1[lane] = hp2 * highG + bp2;
+            float lp2 = bp2 * highG + highS2[lane];
+            highS2[lane] = bp2 * highG + lp2;
+            
+            frame[lane] = lp2;
+        }
+    }
+    
+private:
+    void calculateCoefficients(float cutoff, float& g, float& h, float& gr) const noexcept;
+    
+    double sampleRate = 44100.0;
+    float R2 = 0.0f;  // 1 / resonance, the same for both filters
+    
+    float lastLowCut = -1.0f;
+    float lastHighCut = -1.0f;
+    
+    float lowG = 0.0f, lowH = 0.0f, lowGR = 0.0f;
+    float highG = 0.0f, highH = 0.0f, highGR = 0.0f;
+    
+    alignas(16) float lowS1[numLanes] = {};
+    alignas(16) float lowS2[numLanes] = {};
+    alignas(16) float highS1[numLanes] = {};
+    alignas(16) float highS2[numLanes] = {};
+};
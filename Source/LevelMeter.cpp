@@ -2,12 +2,17 @@
 #include "LevelMeter.h"
 #include "LookAndFeel.h"
 
-LevelMeter::LevelMeter(Measurement& measurementL_, Measurement& measurementR_)
-    : measurementL(measurementL_), measurementR(measurementR_),
-      dbLevelL(clampdB), dbLevelR(clampdB)
+LevelMeter::LevelMeter(Measurement& measurement_)
+    : RefreshClient(static_cast<juce::Component&>(*this)),
+      measurement(measurement_),
+      dbLevelL(clampdB), dbLevelR(clampdB),
+      dbRmsL(clampdB), dbRmsR(clampdB)
 {
+    // Whatever is in there is from before the editor was opened.
+    measurement.clear();
+
     setOpaque(true);
-    startTimerHz(refreshRate);
+    startRefreshHz(refreshRate);
     decay = 1.0f - std::exp(-1.0f / (float(refreshRate) * 0.2f));
 }
 
@@ -16,13 +21,31 @@ LevelMeter::~LevelMeter()
 }
 
 void LevelMeter::paint (juce::Graphics& g)
+{
+    g.fillAll(Colors::LevelMeter::background);
+
+    drawLevel(g, dbLevelL, dbRmsL, barLX, barWidth);
+    drawLevel(g, dbLevelR, dbRmsR, barRX, barWidth);
+
+    float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (ticks.isNull() || scale != ticksScale) {
+        renderTicks(scale);
+    }
+    g.drawImage(ticks, getLocalBounds().toFloat());
+}
+
+void LevelMeter::renderTicks(float scale)
 {
     const auto bounds = getLocalBounds();
 
-    g.fillAll(Colors::LevelMeter::background);
+    ticks = juce::Image(juce::Image::ARGB,
+                        std::max(1, juce::roundToInt(float(bounds.getWidth()) * scale)),
+                        std::max(1, juce::roundToInt(float(bounds.getHeight()) * scale)),
+                        true);
+    ticksScale = scale;
 
-    drawLevel(g, dbLevelL, 0, 7);
-    drawLevel(g, dbLevelR, 9, 7);
+    juce::Graphics g(ticks);
+    g.addTransform(juce::AffineTransform::scale(scale));
 
     g.setFont(Fonts::getFont(10.0f));
     for (float db = maxdB; db >= mindB; db -= stepdB) {
@@ -41,17 +64,60 @@ void LevelMeter::resized()
 {
     maxPos = 4.0f;
     minPos = float(getHeight()) - 4.0f;
+
+    ticks = juce::Image();
+    barL = barPositionForLevel(dbLevelL);
+    barR = barPositionForLevel(dbLevelR);
+    rmsBarL = barPositionForLevel(dbRmsL);
+    rmsBarR = barPositionForLevel(dbRmsR);
 }
 
-void LevelMeter::timerCallback()
+void LevelMeter::refresh()
 {
-    updateLevel(measurementL.readAndReset(), levelL, dbLevelL);
-    updateLevel(measurementR.readAndReset(), levelR, dbLevelR);
+    // The loudest of the blocks that were processed since the last time.
+    // The bars follow the true peak, so that overs between the samples show
+    // too, with the RMS inside them. A mono output shows on both bars.
+    float peakL = 0.0f;
+    float peakR = 0.0f;
+    float rmsL = 0.0f;
+    float rmsR = 0.0f;
+    MeterFrame frame;
+    while (measurement.pop(frame)) {
+        int right = frame.numChannels > 1 ? 1 : 0;
+        peakL = std::max(peakL, frame.truePeak[0]);
+        peakR = std::max(peakR, frame.truePeak[right]);
+        rmsL = std::max(rmsL, frame.rms[0]);
+        rmsR = std::max(rmsR, frame.rms[right]);
+    }
+
+    updateLevel(peakL, levelL, dbLevelL);
+    updateLevel(peakR, levelR, dbLevelR);
+    updateLevel(rmsL, rmsLevelL, dbRmsL);
+    updateLevel(rmsR, rmsLevelR, dbRmsR);
+
+    updateBar(dbLevelL, barLX, barL);
+    updateBar(dbLevelR, barRX, barR);
+    updateBar(dbRmsL, barLX, rmsBarL);
+    updateBar(dbRmsR, barRX, rmsBarR);
+
+    bool atRest = barL == getHeight() && barR == getHeight();
+    if (atRest != idle) {
+        idle = atRest;
+        startRefreshHz(idle ? idleRefreshRate : refreshRate);
+    }
+}
 
-    repaint();
+void LevelMeter::updateBar(float dbLevel, int x, int& barPosition)
+{
+    int newPosition = barPositionForLevel(dbLevel);
+    if (newPosition != barPosition) {
+        int top = std::min(newPosition, barPosition);
+        repaint(x, top, barWidth, std::max(newPosition, barPosition) - top);
+        barPosition = newPosition;
+    }
 }
 
-void LevelMeter::drawLevel(juce::Graphics& g, float level, int x, int width)
+void LevelMeter::drawLevel(juce::Graphics& g, float level, float rmsLevel, int x, int width)
 {
     int y = positionForLevel(level);
     if (level > 0.0f) {
@@ -64,6 +130,13 @@ void LevelMeter::drawLevel(juce::Graphics& g, float level, int x, int width)
         g.setColour(Colors::LevelMeter::levelOK);
         g.fillRect(x, y, width, getHeight() - y);
     }
+
+    // The RMS is never above the peak, so it always fits inside the bar.
+    int rmsY = std::max(y, barPositionForLevel(rmsLevel));
+    if (rmsY < getHeight()) {
+        g.setColour(Colors::LevelMeter::rms);
+        g.fillRect(x, rmsY, width, getHeight() - rmsY);
+    }
 }
 
 void LevelMeter::updateLevel(float newLevel, float& smoothedLevel, float& leveldB) const
@@ -2,29 +2,37 @@
 
 #include <JuceHeader.h>
 #include "Measurement.h"
+#include "RefreshScheduler.h"
 
-class LevelMeter  : public juce::Component, private juce::Timer
+class LevelMeter  : public juce::Component, private RefreshClient
 {
 public:
-    LevelMeter(Measurement& measurementL, Measurement& measurementR);
+    LevelMeter(Measurement& measurement);
     ~LevelMeter() override;
 
     void paint (juce::Graphics&) override;
     void resized() override;
 
 private:
-    void timerCallback() override;
+    void refresh() override;
 
     int positionForLevel(float dbLevel) const noexcept
     {
         return int(std::round(juce::jmap(dbLevel, maxdB, mindB, maxPos, minPos)));
     }
 
-    void drawLevel(juce::Graphics& g, float level, int x, int width);
+    // Where the top of a bar is, clamped to the component.
+    int barPositionForLevel(float dbLevel) const noexcept
+    {
+        return juce::jlimit(0, getHeight(), positionForLevel(dbLevel));
+    }
+
+    void drawLevel(juce::Graphics& g, float level, float rmsLevel, int x, int width);
     void updateLevel(float newLevel, float& smoothedLevel, float& leveldB) const;
+    void updateBar(float dbLevel, int x, int& barPosition);
+    void renderTicks(float scale);
 
-    Measurement& measurementL;
-    Measurement& measurementR;
+    Measurement& measurement;
 
     static constexpr float maxdB = 6.0f;
     static constexpr float mindB = -60.0f;
@@ -38,12 +46,35 @@ private:
 
     float dbLevelL;
     float dbLevelR;
+    float dbRmsL;
+    float dbRmsR;
+
+    // Only the part of a bar that moved gets repainted. barL and barR are
+    // the bar positions as last painted, rmsBarL and rmsBarR the top of the
+    // RMS part inside them.
+    static constexpr int barLX = 0;
+    static constexpr int barRX = 9;
+    static constexpr int barWidth = 7;
+    int barL = 0;
+    int barR = 0;
+    int rmsBarL = 0;
+    int rmsBarR = 0;
+
+    // The tick lines and labels, rendered at the display's pixel scale.
+    juce::Image ticks;
+    float ticksScale = 0.0f;
 
+    // Once both bars have fallen out of sight, the meter only checks now
+    // and then whether the sound has come back.
     static constexpr int refreshRate = 60;
+    static constexpr int idleRefreshRate = 10;
+    bool idle = false;
 
     float decay = 0.0f;
     float levelL = clampLevel;
     float levelR = clampLevel;
+    float rmsLevelL = clampLevel;
+    float rmsLevelR = clampLevel;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeter)
 };
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands values from one thread to another without locks. One thread is the
+// only one that pushes and one other thread the only one that pops, so each
+// index only has a single writer. When the reader falls behind (or there is
+// no editor open), new values are dropped, so a new reader should clear()
+// the stale ones first.
+template<typename T, std::uint32_t capacity>
+class LockFreeFifo
+{
+public:
+    static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+    
+    // Writer
+    bool push(const T& value) noexcept
+    {
+        auto write = writeIndex.load(std::memory_order_relaxed);
+        if (write - readIndex.load(std::memory_order_acquire) == capacity) { return false; }
+        
+        values[write & (capacity - 1)] = value;
+        writeIndex.store(write + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Reader
+    bool pop(T& value) noexcept
+    {
+        auto read = readIndex.load(std::memory_order_relaxed);
+        if (read == writeIndex.load(std::memory_order_acquire)) { return false; }
+        
+        value = values[read & (capacity - 1)];
+        readIndex.store(read + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Reader. Throws away everything that was pushed so far, such as what
+    // piled up while nobody was reading.
+    void clear() noexcept
+    {
+        readIndex.store(writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+    }
+    
+private:
+    std::array<T, capacity> values;
+    std::atomic<std::uint32_t> writeIndex { 0 };
+    std::atomic<std::uint32_t> readIndex { 0 };
+};
@@ -66,31 +66,16 @@ void RotaryKnobLookAndFeel::drawRotarySlider(juce::Graphics& g, int x, int y, in
     auto bounds = juce::Rectangle<int>(x, y, width, width).toFloat();
     auto knobRect = bounds.reduced(10.0f, 10.0f);
     
-    auto path = juce::Path();
-    path.addEllipse(knobRect);
-    dropShadow.drawForPath(g, path);
-    
-    g.setColour(Colors::Knob::outline);
-    g.fillEllipse(knobRect);
+    float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    g.drawImage(getKnobBody(width, scale, rotaryStartAngle, rotaryEndAngle), bounds);
     
+    // Only the dial and the value arc are drawn live.
     auto innerRect = knobRect.reduced(2.0f, 2.0f);
-    auto gradient = juce::ColourGradient(
-        Colors::Knob::gradientTop, 0.0f, innerRect.getY(),
-    Colors::Knob::gradientBottom, 0.0f, innerRect.getBottom(), false);
-    g.setGradientFill(gradient);
-    g.fillEllipse(innerRect);
-    
     auto center = bounds.getCentre();
     auto radius = bounds.getWidth() / 2.0f;
     auto lineWidth = 3.0f;
     auto arcRadius = radius - lineWidth/2.0f;
-    
-    juce::Path backgroundArc;
-    backgroundArc.addCentredArc(center.x, center.y, arcRadius, arcRadius, 0.0f, rotaryStartAngle, rotaryEndAngle, true);
-    
     auto strokeType = juce::PathStrokeType(lineWidth, juce::PathStrokeType::curved, juce::PathStrokeType::rounded);
-    g.setColour(Colors::Knob::trackBackground);
-    g.strokePath(backgroundArc, strokeType);
     
     auto dialRadius = innerRect.getHeight() / 2.0f - lineWidth;
     auto toAngle = rotaryStartAngle + sliderPos * (rotaryEndAngle - rotaryStartAngle);
@@ -118,6 +103,60 @@ void RotaryKnobLookAndFeel::drawRotarySlider(juce::Graphics& g, int x, int y, in
     
 }
 
+juce::Image RotaryKnobLookAndFeel::getKnobBody(int size, float scale, float rotaryStartAngle, float rotaryEndAngle)
+{
+    juce::int64 hash = 0x6b6e6f62;  // "knob"
+    for (int value : { size, juce::roundToInt(scale * 100.0f),
+                       juce::roundToInt(rotaryStartAngle * 1000.0f), juce::roundToInt(rotaryEndAngle * 1000.0f) }) {
+        hash = hash * 31 + value;
+    }
+    
+    auto image = juce::ImageCache::getFromHashCode(hash);
+    if (image.isValid()) {
+        return image;
+    }
+    
+    int pixels = std::max(1, juce::roundToInt(float(size) * scale));
+    image = juce::Image(juce::Image::ARGB, pixels, pixels, true);
+    {
+        // The Graphics has to be gone before the image is used.
+        juce::Graphics g(image);
+        g.addTransform(juce::AffineTransform::scale(scale));
+        
+        auto bounds = juce::Rectangle<int>(0, 0, size, size).toFloat();
+        auto knobRect = bounds.reduced(10.0f, 10.0f);
+        
+        auto path = juce::Path();
+        path.addEllipse(knobRect);
+        dropShadow.drawForPath(g, path);
+        
+        g.setColour(Colors::Knob::outline);
+        g.fillEllipse(knobRect);
+        
+        auto innerRect = knobRect.reduced(2.0f, 2.0f);
+        auto gradient = juce::ColourGradient(
+            Colors::Knob::gradientTop, 0.0f, innerRect.getY(),
+        Colors::Knob::gradientBottom, 0.0f, innerRect.getBottom(), false);
+        g.setGradientFill(gradient);
+        g.fillEllipse(innerRect);
+        
+        auto center = bounds.getCentre();
+        auto radius = bounds.getWidth() / 2.0f;
+        auto lineWidth = 3.0f;
+        auto arcRadius = radius - lineWidth/2.0f;
+        
+        juce::Path backgroundArc;
+        backgroundArc.addCentredArc(center.x, center.y, arcRadius, arcRadius, 0.0f, rotaryStartAngle, rotaryEndAngle, true);
+        
+        auto strokeType = juce::PathStrokeType(lineWidth, juce::PathStrokeType::curved, juce::PathStrokeType::rounded);
+        g.setColour(Colors::Knob::trackBackground);
+        g.strokePath(backgroundArc, strokeType);
+    }
+    
+    juce::ImageCache::addImageToCache(image, hash);
+    return image;
+}
+
 juce::Font RotaryKnobLookAndFeel::getLabelFont([[maybe_unused]] juce::Label& label)
 {
     return Fonts::getFont();
@@ -44,6 +44,17 @@ namespace Colors
         const juce::Colour tickLabel { 226, 74, 81 };
         const juce::Colour tooLoud { 226, 74, 81 };
         const juce::Colour levelOK { 65, 206, 80 };
+        const juce::Colour rms { 40, 150, 55 };
+    }
+
+    namespace Scope
+    {
+        const juce::Colour background { 240, 235, 230 };
+        const juce::Colour axis { 220, 215, 210 };
+        const juce::Colour waveform { 177, 101, 135 };
+        const juce::Colour delayMarker { 80, 80, 80 };
+        const juce::Colour tapMarker { 160, 155, 150 };
+        const juce::Colour decay { 226, 74, 81 };
     }
 }
 
@@ -69,6 +80,11 @@ public:
     
     
 private:
+    // Everything about a knob that doesn't depend on its value: the shadow,
+    // the body and the track. It's rendered once for every size and display
+    // scale and shared by all knobs through the juce::ImageCache.
+    juce::Image getKnobBody(int size, float scale, float rotaryStartAngle, float rotaryEndAngle);
+    
     juce::DropShadow dropShadow { Colors::Knob::dropShadow, 6, { 0, 3 } };
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RotaryKnobLookAndFeel)
@@ -1,24 +1,21 @@
 #pragma once
 
-#include <atomic>
+#include "LockFreeFifo.h"
 
-struct Measurement
+// The output level of one or more processed blocks. Every value is linear
+// gain: the sample peak, the RMS, and the true peak, which is the peak of the
+// signal oversampled 4x and so also catches the overs between the samples.
+struct MeterFrame
 {
-    void reset() noexcept
-    {
-        value.store(0.0f);
-    }
+    static constexpr int maxChannels = 2;
     
-    void updateIfGreater(float newValue) noexcept
-    {
-        auto oldValue = value.load();
-        while (newValue > oldValue && !value.compare_exchange_weak(oldValue, newValue));
-    }
-    
-    float readAndReset() noexcept
-    {
-        return value.exchange(0.0f);
-    }
-    
-    std::atomic<float> value;
+    int numChannels = 0;
+    float peak[maxChannels] = {};
+    float rms[maxChannels] = {};
+    float truePeak[maxChannels] = {};
 };
+
+// Meter frames on their way from the audio thread to the level meter. A frame
+// covers at least a millisecond, so this holds a quarter of a second or more,
+// well over the time between two refreshes of the meter.
+using Measurement = LockFreeFifo<MeterFrame, 256>;
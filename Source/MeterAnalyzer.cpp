@@ -0,0 +1,140 @@
+#include "MeterAnalyzer.h"
+
+#if JUCE_USE_SIMD
+using SIMDFloat = juce::dsp::SIMDRegister<float>;
+#endif
+
+static float getPeak(const float* data, int numSamples) noexcept
+{
+    auto range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+    return std::max(-range.getStart(), range.getEnd());
+}
+
+static float getSumOfSquares(const float* data, int numSamples) noexcept
+{
+    float sum = 0.0f;
+    int i = 0;
+   
+   #if JUCE_USE_SIMD
+    // Up to the first aligned sample one at a time, then a register's worth
+    // at a time, with the four partial sums added up at the end.
+    auto* aligned = SIMDFloat::getNextSIMDAlignedPtr(const_cast<float*>(data));
+    int head = std::min(numSamples, int(aligned - data));
+    for (; i < head; ++i) {
+        sum += data[i] * data[i];
+    }
+    
+    constexpr int vecSize = int(SIMDFloat::SIMDNumElements);
+    auto sums = SIMDFloat::expand(0.0f);
+    for (; i + vecSize <= numSamples; i += vecSize) {
+        auto x = SIMDFloat::fromRawArray(data + i);
+        sums = SIMDFloat::multiplyAdd(sums, x, x);
+    }
+    sum += sums.sum();
+   #endif
+    
+    for (; i < numSamples; ++i) {
+        sum += data[i] * data[i];
+    }
+    return sum;
+}
+
+MeterAnalyzer::MeterAnalyzer()
+{
+    // Windowed sinc low-pass at the original Nyquist frequency, split into
+    // one set of taps per phase. The center falls on a tap, so phase 0 is
+    // the input itself, and the other phases land exactly a quarter, half
+    // and three quarters of the way between the samples. Each phase is
+    // normalized to unity gain at DC, so a constant signal reads the same
+    // as its sample peak.
+    constexpr int numTaps = oversampling * tapsPerPhase;
+    constexpr double center = 0.5 * numTaps;
+    for (int phase = 0; phase < oversampling; ++phase) {
+        double sum = 0.0;
+        for (int tap = 0; tap < tapsPerPhase; ++tap) {
+            int n = phase + tap * oversampling;
+            double x = juce::MathConstants<double>::pi * (double(n) - center) / oversampling;
+            double sinc = x == 0.0 ? 1.0 : std::sin(x) / x;
+            double window = 0.5 + 0.5 * std::cos(juce::MathConstants<double>::twoPi * (double(n) - center) / (numTaps + 1));
+            coefficients[phase][tap] = float(sinc * window);
+            sum += sinc * window;
+        }
+        for (int tap = 0; tap < tapsPerPhase; ++tap) {
+            coefficients[phase][tap] = float(coefficients[phase][tap] / sum);
+        }
+    }
+}
+
+void MeterAnalyzer::prepare(int blockSize)
+{
+    maxBlockSize = blockSize;
+    for (auto& channel : channels) {
+        channel.input.resize(size_t(historySize + maxBlockSize));
+    }
+    upsampled.resize(size_t(maxBlockSize));
+    reset();
+}
+
+void MeterAnalyzer::reset() noexcept
+{
+    for (auto& channel : channels) {
+        std::fill(channel.input.begin(), channel.input.end(), 0.0f);
+    }
+    finishFrame();
+}
+
+void MeterAnalyzer::process(int channelIndex, const float* data, int numSamples) noexcept
+{
+    auto& channel = channels[channelIndex];
+    channel.numSamples += numSamples;
+    
+    while (numSamples > 0) {
+        int count = std::min(numSamples, maxBlockSize);
+        channel.peak = std::max(channel.peak, getPeak(data, count));
+        channel.sumOfSquares += getSumOfSquares(data, count);
+        measureTruePeak(channelIndex, data, count);
+        
+        data += count;
+        numSamples -= count;
+    }
+}
+
+void MeterAnalyzer::measureTruePeak(int channelIndex, const float* data, int numSamples) noexcept
+{
+    auto& channel = channels[channelIndex];
+    float* input = channel.input.data() + historySize;
+    juce::FloatVectorOperations::copy(input, data, numSamples);
+    
+    // upsampled[i] = sum over the taps of coefficients[phase][tap] * input[i - tap]
+    for (int phase = 0; phase < oversampling; ++phase) {
+        juce::FloatVectorOperations::multiply(upsampled.data(), input, coefficients[phase][0], numSamples);
+        for (int tap = 1; tap < tapsPerPhase; ++tap) {
+            juce::FloatVectorOperations::addWithMultiply(upsampled.data(), input - tap,
+                                                         coefficients[phase][tap], numSamples);
+        }
+        channel.truePeak = std::max(channel.truePeak, getPeak(upsampled.data(), numSamples));
+    }
+    
+    // Keep the end of this block for the start of the next one. The ranges
+    // overlap when the block is shorter than the history.
+    std::memmove(channel.input.data(), channel.input.data() + numSamples, sizeof(float) * size_t(historySize));
+}
+
+MeterFrame MeterAnalyzer::finishFrame() noexcept
+{
+    MeterFrame frame;
+    for (int i = 0; i < MeterFrame::maxChannels; ++i) {
+        auto& channel = channels[i];
+        if (channel.numSamples > 0) {
+            frame.numChannels = i + 1;
+            frame.peak[i] = channel.peak;
+            frame.rms[i] = float(std::sqrt(channel.sumOfSquares / channel.numSamples));
+            frame.truePeak[i] = std::max(channel.truePeak, channel.peak);
+        }
+        channel.peak = 0.0f;
+        channel.truePeak = 0.0f;
+        channel.sumOfSquares = 0.0;
+        channel.numSamples = 0;
+    }
+    return frame;
+}
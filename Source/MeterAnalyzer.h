@@ -0,0 +1,58 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "Measurement.h"
+
+// Measures the output for the level meter, one MeterFrame per block. All of
+// it runs on whole arrays: the peaks are FloatVectorOperations reductions,
+// the sum of squares is a SIMD loop, and the 4x oversampling for the true
+// peak is a polyphase FIR filter that is applied one tap at a time to the
+// whole block with addWithMultiply.
+class MeterAnalyzer
+{
+public:
+    MeterAnalyzer();
+    
+    // Longer blocks are measured in pieces of blockSize samples.
+    void prepare(int blockSize);
+    void reset() noexcept;
+    
+    // Adds numSamples of the given channel to the frame being measured.
+    void process(int channel, const float* data, int numSamples) noexcept;
+    
+    // Returns what was measured since the previous call and starts over.
+    MeterFrame finishFrame() noexcept;
+    
+    // How many samples per channel the frame being measured covers so far.
+    int getNumSamples() const noexcept
+    {
+        return channels[0].numSamples;
+    }
+
+private:
+    void measureTruePeak(int channel, const float* data, int numSamples) noexcept;
+    
+    static constexpr int oversampling = 4;
+    static constexpr int tapsPerPhase = 12;
+    static constexpr int historySize = tapsPerPhase - 1;
+    
+    // coefficients[phase][tap]
+    float coefficients[oversampling][tapsPerPhase];
+    
+    struct Channel
+    {
+        float peak = 0.0f;
+        float truePeak = 0.0f;
+        double sumOfSquares = 0.0;
+        int numSamples = 0;
+        
+        // The last historySize samples of the previous block, followed by
+        // the samples being oversampled.
+        std::vector<float> input;
+    };
+    Channel channels[MeterFrame::maxChannels];
+    
+    std::vector<float> upsampled;
+    int maxBlockSize = 0;
+};
@@ -1,5 +1,7 @@
 #include "Parameters.h"
 #include "DSP.h"
+#include "Tempo.h"
+#include <bit>
 
 template<typename T>
 static void castParameter(juce::AudioProcessorValueTreeState& apvts, const juce::ParameterID& id, T& destination)
@@ -20,45 +22,219 @@ Parameters::Parameters(juce::AudioProcessorValueTreeState& apvts)
     castParameter(apvts, tempoSyncParamID, tempoSyncParam);
     castParameter(apvts, delayNoteParamID, delayNoteParam);
     castParameter(apvts, bypassParamID, bypassParam);
+    castParameter(apvts, pingPongParamID, pingPongParam);
+    castParameter(apvts, delayModeParamID, delayModeParam);
+    castParameter(apvts, crossfadeParamID, crossfadeParam);
+    castParameter(apvts, trailsParamID, trailsParam);
+    
+    for (int i = 0; i < numTaps; ++i) {
+        auto& tap = tapParams[size_t(i)];
+        castParameter(apvts, tapParamID(i, "Time"), tap.timeParam);
+        castParameter(apvts, tapParamID(i, "Level"), tap.levelParam);
+        castParameter(apvts, tapParamID(i, "Pan"), tap.panParam);
+        castParameter(apvts, tapParamID(i, "Note"), tap.noteParam);
+    }
+    
+    for (size_t i = 0; i < stateParameters.size(); ++i) {
+        stateParameters[i] = apvts.getParameter(stateParameterIDs[i]);
+        jassert(stateParameters[i] != nullptr);
+    }
+    
+    // A parameter that's missing from stateParameterIDs wouldn't be saved.
+    auto allParameters = getAllParameters();
+    jassert(allParameters.size() == stateParameters.size());
+    
+    for (auto* param : allParameters) {
+        int index = param->getParameterIndex();
+        jassert(index >= 0 && index < 64);
+        parametersByIndex[size_t(index)] = param;
+        param->addListener(this);
+    }
 }
 
-void Parameters::update() noexcept
+Parameters::~Parameters()
 {
-    gainSmoother.setTargetValue(juce::Decibels::decibelsToGain(gainParam->get()));
-    feedbackSmoother.setTargetValue(feedbackParam->get() * 0.01f);
-    mixSmoother.setTargetValue(mixParam->get() * 0.01f);
-    lowCutSmoother.setCurrentAndTargetValue(lowCutParam->get());
-    highCutSmoother.setCurrentAndTargetValue(highCutParam->get());
+    for (auto* param : getAllParameters()) {
+        param->removeListener(this);
+    }
+}
 
-    targetDelayTime = delayTimeParam->get();
-    if (delayTime == 0.0f) {
-        delayTime = targetDelayTime;
+void Parameters::writeState(juce::MemoryBlock& destData) const
+{
+    State state;
+    state.tag = stateTag;
+    state.version = stateVersion;
+    state.numValues = numParameters;
+    for (int i = 0; i < numParameters; ++i) {
+        auto* param = stateParameters[size_t(i)];
+        state.values[i] = param->convertFrom0to1(param->getValue());
     }
-    delayNote = delayNoteParam->getIndex();
-    tempoSync = tempoSyncParam->get();
-    bypassed = bypassParam->get();
+    destData.replaceAll(&state, sizeof(state));
 }
 
-void Parameters::prepareToPlay(double sampleRate) noexcept
+bool Parameters::readState(const void* data, int sizeInBytes)
 {
+    if (data == nullptr || sizeInBytes < stateHeaderSize) { return false; }
+    
+    // The host's data may not be aligned, so it's copied out rather than cast.
+    State state;
+    std::memcpy(&state, data, size_t(stateHeaderSize));
+    if (state.tag != stateTag) { return false; }
+    
+    // A state from a newer version of the plug-in can't be trusted to mean
+    // the same thing. It's left to the caller, like any other format this
+    // doesn't know.
+    if (state.version > stateVersion) { return false; }
+    
+    int available = (sizeInBytes - stateHeaderSize) / int(sizeof(float));
+    int numValues = std::min({ int(state.numValues), available, numParameters });
+    std::memcpy(state.values, static_cast<const char*>(data) + stateHeaderSize,
+                sizeof(float) * size_t(numValues));
+    
+    for (int i = 0; i < numParameters; ++i) {
+        auto* param = stateParameters[size_t(i)];
+        float value = param->getDefaultValue();
+        if (i < numValues && std::isfinite(state.values[i])) {
+            value = param->convertTo0to1(state.values[i]);
+        }
+        param->setValueNotifyingHost(value);
+    }
+    return true;
+}
+
+std::vector<juce::RangedAudioParameter*> Parameters::getAllParameters() const
+{
+    std::vector<juce::RangedAudioParameter*> params {
+        gainParam, delayTimeParam, mixParam, feedbackParam, stereoParam, lowCutParam,
+        highCutParam, tempoSyncParam, delayNoteParam, bypassParam, pingPongParam,
+        delayModeParam, crossfadeParam, trailsParam
+    };
+    for (const auto& tap : tapParams) {
+        params.insert(params.end(), { tap.timeParam, tap.levelParam, tap.panParam, tap.noteParam });
+    }
+    return params;
+}
+
+void Parameters::update(std::uint64_t deferred) noexcept
+{
+    // The one check per block. Most of the time nothing has changed.
+    if (changedParameters.load(std::memory_order_relaxed) == 0) { return; }
+    
+    std::uint64_t changed = changedParameters.exchange(0, std::memory_order_acquire) & ~deferred;
+    while (changed != 0) {
+        int index = std::countr_zero(changed);
+        changed &= changed - 1;
+        if (auto* param = parametersByIndex[size_t(index)]) {
+            setValue(param, param->convertFrom0to1(param->getValue()));
+        }
+    }
+}
+
+void Parameters::applyChange(const Change& change) noexcept
+{
+    jassert(change.parameterIndex >= 0 && change.parameterIndex < 64);
+    
+    if (auto* param = parametersByIndex[size_t(change.parameterIndex)]) {
+        setValue(param, param->convertFrom0to1(change.value));
+    }
+}
+
+void Parameters::setValue(const juce::AudioProcessorParameter* param, float value) noexcept
+{
+    if (param == gainParam) {
+        gainSmoother.setTargetValue(juce::Decibels::decibelsToGain(value));
+    } else if (param == feedbackParam) {
+        feedbackSmoother.setTargetValue(value * 0.01f);
+    } else if (param == mixParam) {
+        mixSmoother.setTargetValue(value * 0.01f);
+    } else if (param == stereoParam) {
+        stereoSmoother.setTargetValue(value * 0.01f);
+    } else if (param == lowCutParam) {
+        lowCutSmoother.setTargetValue(value);
+    } else if (param == highCutParam) {
+        highCutSmoother.setTargetValue(value);
+    } else if (param == delayTimeParam) {
+        targetDelayTime = value;
+        if (delayTime == 0.0f) {
+            delayTime = targetDelayTime;
+        }
+    } else if (param == delayNoteParam) {
+        delayNote = juce::roundToInt(value);
+    } else if (param == tempoSyncParam) {
+        tempoSync = value >= 0.5f;
+    } else if (param == pingPongParam) {
+        pingPong = value >= 0.5f;
+    } else if (param == crossfadeParam) {
+        crossfadeTime = value;
+    } else if (param == delayModeParam) {
+        // Crossfade, Repitch, Repitch 2x, Repitch 4x
+        int delayMode = juce::roundToInt(value);
+        repitch = delayMode > 0;
+        oversampling = delayMode == 3 ? 4 : (delayMode == 2 ? 2 : 1);
+    } else if (param == bypassParam) {
+        bypassed = value >= 0.5f;
+    } else if (param == trailsParam) {
+        trails = value >= 0.5f;
+    } else {
+        for (size_t i = 0; i < tapParams.size(); ++i) {
+            auto& tap = tapParams[i];
+            if (param == tap.levelParam) {
+                tap.levelSmoother.setTargetValue(value * 0.01f);
+                taps[i].enabled = value > 0.0f;
+            } else if (param == tap.panParam) {
+                tap.panSmoother.setTargetValue(value * 0.01f);
+            } else if (param == tap.timeParam) {
+                taps[i].time = value;
+            } else if (param == tap.noteParam) {
+                taps[i].note = juce::roundToInt(value);
+            }
+        }
+    }
+}
+
+void Parameters::parameterValueChanged(int parameterIndex, float)
+{
+    // Called by the host or the editor, on any thread, after the new value
+    // has been stored.
+    changedParameters.fetch_or(parameterBit(parameterIndex), std::memory_order_release);
+}
+
+void Parameters::prepareToPlay(double sampleRate, int samplesPerBlock)
+{
+    gain.prepare(samplesPerBlock);
+    mix.prepare(samplesPerBlock);
+    feedback.prepare(samplesPerBlock);
+    panL.prepare(samplesPerBlock);
+    panR.prepare(samplesPerBlock);
+    lowCut.prepare(samplesPerBlock);
+    highCut.prepare(samplesPerBlock);
+    
+
     double duration = 0.02;
     gainSmoother.reset(sampleRate, duration);
     feedbackSmoother.reset(sampleRate, duration);
-    coeff = 1.0f - std::exp(-1.0f / (0.2f * float(sampleRate)));
     mixSmoother.reset(sampleRate, duration);
     stereoSmoother.reset(sampleRate, duration);
     lowCutSmoother.reset(sampleRate, duration);
     highCutSmoother.reset(sampleRate, duration);
+    
+    for (auto& tap : tapParams) {
+        tap.levelSmoother.reset(sampleRate, duration);
+        tap.panSmoother.reset(sampleRate, duration);
+    }
 }
 
 void Parameters::reset() noexcept
 {
-    gain = 0.0f;
+    gain.setConstant(0.0f);
     delayTime = 0.0f;
-    mix = 1.0f;
-    feedback = 0.0f;
-    lowCut = 20.0f;
-    highCut = 20000.0f;
+    mix.setConstant(1.0f);
+    feedback.setConstant(0.0f);
+    panL.setConstant(0.0f);
+    panR.setConstant(1.0f);
+    lowCut.setConstant(20.0f);
+    highCut.setConstant(20000.0f);
+    lastStereo = -2.0f;
     
     gainSmoother.setCurrentAndTargetValue(
       juce::Decibels::decibelsToGain(gainParam->get()));
@@ -67,16 +243,94 @@ void Parameters::reset() noexcept
     stereoSmoother.setCurrentAndTargetValue(stereoParam->get() * 0.01f);
     lowCutSmoother.setCurrentAndTargetValue(lowCutParam->get());
     highCutSmoother.setCurrentAndTargetValue(highCutParam->get());
+    
+    for (size_t i = 0; i < tapParams.size(); ++i) {
+        auto& tap = tapParams[i];
+        tap.levelSmoother.setCurrentAndTargetValue(tap.levelParam->get() * 0.01f);
+        tap.panSmoother.setCurrentAndTargetValue(tap.panParam->get() * 0.01f);
+        taps[i] = Tap();
+    }
+    
+    // The next update() reads everything again.
+    changedParameters.store(~std::uint64_t(0));
+}
+
+float Parameters::getRequestedDelayTime(double bpm) const noexcept
+{
+    bool sync = tempoSyncParam->get();
+    auto timeFor = [sync, bpm](const juce::AudioParameterFloat* time, const juce::AudioParameterChoice* note)
+    {
+        if (sync) {
+            float synced = float(Tempo::getMillisecondsForNoteLength(note->getIndex(), bpm));
+            return juce::jlimit(minDelayTime, maxDelayTime, synced);
+        }
+        return time->get();
+    };
+    
+    float longest = timeFor(delayTimeParam, delayNoteParam);
+    for (const auto& tap : tapParams) {
+        if (tap.levelParam->get() > 0.0f) {
+            longest = std::max(longest, timeFor(tap.timeParam, tap.noteParam));
+        }
+    }
+    return longest;
 }
 
-void Parameters::smoothen() noexcept
+void Parameters::smoothen(int numSamples) noexcept
 {
-    gain = gainSmoother.getNextValue();
-//    delayTime += (targetDelayTime - delayTime) * coeff; // Repitch mode
-    delayTime = targetDelayTime; // Fade mode
-    mix = mixSmoother.getNextValue();
-    feedback = feedbackSmoother.getNextValue();
-    panningEqualPower(stereoSmoother.getNextValue(), panL, panR);
-    lowCut = lowCutSmoother.getNextValue();
-    highCut = highCutSmoother.getNextValue();
+    gain.render(gainSmoother, numSamples);
+    delayTime = targetDelayTime;  // the processor crossfades or glides to it
+    mix.render(mixSmoother, numSamples);
+    feedback.render(feedbackSmoother, numSamples);
+    
+    // Only evaluate the pan law per sample while the stereo knob is actually
+    // moving.
+    if (stereoSmoother.isSmoothing()) {
+        float* left = panL.startRamp();
+        float* right = panR.startRamp();
+        for (int i = 0; i < numSamples; ++i) {
+            left[i] = stereoSmoother.getNextValue();
+        }
+        panningEqualPower(left, left, right, numSamples);
+        panL.endRamp(numSamples);
+        panR.endRamp(numSamples);
+        lastStereo = -2.0f;
+    } else if (float stereo = stereoSmoother.getCurrentValue(); stereo != lastStereo) {
+        float left, right;
+        panningEqualPower(stereo, left, right);
+        panL.setConstant(left);
+        panR.setConstant(right);
+        lastStereo = stereo;
+    }
+    
+    lowCut.render(lowCutSmoother, numSamples);
+    highCut.render(highCutSmoother, numSamples);
+    
+    smoothenTaps(numSamples);
+}
+
+void Parameters::smoothenTaps(int numSamples) noexcept
+{
+    for (size_t i = 0; i < tapParams.size(); ++i) {
+        auto& tap = tapParams[i];
+        
+        float startL, startR;
+        panningBalance(tap.panSmoother.getCurrentValue(), startL, startR);
+        float startLevel = tap.levelSmoother.getCurrentValue();
+        
+        float endL, endR;
+        panningBalance(tap.panSmoother.skip(numSamples), endL, endR);
+        float endLevel = tap.levelSmoother.skip(numSamples);
+        
+        // A tap that is turned all the way down costs nothing.
+        taps[i].active = startLevel > 0.0f || endLevel > 0.0f;
+        
+        // The gains ramp linearly over the block. That is exact for the level
+        // and close enough for the balance.
+        float scale = 1.0f / float(numSamples);
+        taps[i].gainL = startLevel * startL;
+        taps[i].gainR = startLevel * startR;
+        taps[i].gainIncrementL = (endLevel * endL - taps[i].gainL) * scale;
+        taps[i].gainIncrementR = (endLevel * endR - taps[i].gainR) * scale;
+    }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "BlockValue.h"
 
 const juce::ParameterID gainParamID { "gain", 1 };
 const juce::ParameterID delayTimeParamID { "delayTime", 1 };
@@ -12,30 +13,113 @@ const juce::ParameterID highCutParamID { "highCut", 1 };
 const juce::ParameterID tempoSyncParamID { "tempoSync", 1 };
 const juce::ParameterID delayNoteParamID { "delayNote", 1 };
 const juce::ParameterID bypassParamID { "bypass", 1 };
+const juce::ParameterID pingPongParamID { "pingPong", 1 };
+const juce::ParameterID delayModeParamID { "delayMode", 1 };
+const juce::ParameterID crossfadeParamID { "crossfade", 1 };
+const juce::ParameterID trailsParamID { "trails", 1 };
 
-class Parameters
+// The multi-tap parameters are numbered: "tap1Time", "tap1Level", ...
+inline juce::ParameterID tapParamID(int tap, const char* name)
+{
+    return juce::ParameterID { "tap" + juce::String(tap + 1) + name, 1 };
+}
+
+class Parameters : private juce::AudioProcessorParameter::Listener
 {
 public:
     Parameters(juce::AudioProcessorValueTreeState& apvts);
+    ~Parameters() override;
     
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     
-    void prepareToPlay(double sampleRate) noexcept;
+    void prepareToPlay(double sampleRate, int samplesPerBlock);
     void reset() noexcept;
-    void update() noexcept;
-    void smoothen() noexcept;
+    
+    // Picks up the parameters that changed since the last call. Changes are
+    // flagged by the parameters' listener callback, so when nothing changed
+    // this is a single atomic load. Parameters with a bit set in deferred
+    // are left alone, because applyChange() will move them during the block.
+    void update(std::uint64_t deferred = 0) noexcept;
+    
+    // A parameter change at a given sample of the block, for sample-accurate
+    // automation. parameterIndex is the index in the processor and value is
+    // normalized, like the host sends it.
+    struct Change
+    {
+        int sampleOffset = 0;
+        int parameterIndex = 0;
+        float value = 0.0f;
+    };
+    
+    void applyChange(const Change& change) noexcept;
+    
+    static std::uint64_t parameterBit(int parameterIndex) noexcept
+    {
+        return std::uint64_t(1) << parameterIndex;
+    }
+    
+    // Compact binary state: a small header and then the plain value of every
+    // parameter, in the order of stateParameterIDs. It's written straight
+    // into destData, without building a ValueTree or XML first. readState()
+    // returns false when the data is in some other format, such as the XML
+    // that older versions saved, or was written by a newer version.
+    void writeState(juce::MemoryBlock& destData) const;
+    bool readState(const void* data, int sizeInBytes);
+    
+    // Renders the smoothed parameters for the next numSamples samples, which
+    // must not be more than the samplesPerBlock given to prepareToPlay().
+    void smoothen(int numSamples) noexcept;
 
-    float gain = 0.0f;
+    BlockValue gain;
     float delayTime = 0.0f;
-    float mix = 1.0f;
-    float feedback = 0.0f;
-    float panL = 0.0f;
-    float panR = 1.0f;
-    float lowCut = 20.0f;
-    float highCut = 20000.0f;
+    BlockValue mix;
+    BlockValue feedback;
+    BlockValue panL;
+    BlockValue panR;
+    
+    BlockValue lowCut;
+    BlockValue highCut;
     int delayNote = 0;
+    
+    // Extra taps that read from the same delay line as the main delay. They
+    // go straight to the output and are not fed back. The gains are where the
+    // tap starts in this block, plus the change per sample.
+    struct Tap
+    {
+        float time = 0.0f;
+        int note = 0;
+        bool enabled = false;  // its level is turned up
+        bool active = false;   // it's audible in this segment
+        float gainL = 0.0f;
+        float gainR = 0.0f;
+        float gainIncrementL = 0.0f;
+        float gainIncrementR = 0.0f;
+    };
+    static constexpr int numTaps = 4;
+    std::array<Tap, numTaps> taps;
+    
+    // Where the delay time knob is, while delayTime is still getting there.
+    float getTargetDelayTime() const noexcept
+    {
+        return targetDelayTime;
+    }
+    
+    // The longest delay time the knobs ask for, in milliseconds, at the
+    // given tempo. Unlike the values here, this reads the parameters
+    // themselves, so it can be called from any thread.
+    float getRequestedDelayTime(double bpm) const noexcept;
+    
     bool tempoSync = false;
+    bool pingPong = true;
+    
+    // In repitch mode a new delay time glides in, like a tape delay, instead
+    // of fading out and back in. oversampling is the most the read head's
+    // anti-aliasing may widen, 1, 2 or 4.
+    bool repitch = false;
+    int oversampling = 1;
+    float crossfadeTime = 50.0f;  // milliseconds
     bool bypassed = false;
+    bool trails = false;  // let the echoes ring out while bypassed
     static constexpr float minDelayTime = 5.0f;
     static constexpr float maxDelayTime = 5000.0f;
 
@@ -51,6 +135,21 @@ private:
     juce::AudioParameterFloat* lowCutParam;
     juce::AudioParameterFloat* highCutParam;
     juce::AudioParameterChoice* delayNoteParam;
+    juce::AudioParameterBool* pingPongParam;
+    juce::AudioParameterChoice* delayModeParam;
+    juce::AudioParameterFloat* crossfadeParam;
+    juce::AudioParameterBool* trailsParam;
+    
+    struct TapParameters
+    {
+        juce::AudioParameterFloat* timeParam;
+        juce::AudioParameterFloat* levelParam;
+        juce::AudioParameterFloat* panParam;
+        juce::AudioParameterChoice* noteParam;
+        juce::LinearSmoothedValue<float> levelSmoother;
+        juce::LinearSmoothedValue<float> panSmoother;
+    };
+    std::array<TapParameters, numTaps> tapParams;
     
     juce::LinearSmoothedValue<float> gainSmoother;
     juce::LinearSmoothedValue<float> mixSmoother;
@@ -60,5 +159,46 @@ private:
     juce::LinearSmoothedValue<float> highCutSmoother;
     
     float targetDelayTime = 0.0f;
-    float coeff = 0.0f; // one-pole smoothing
+    float lastStereo = -2.0f;  // invalid, forces the first pan calculation
+    
+    void smoothenTaps(int numSamples) noexcept;
+    
+    // One bit per parameter, by its index in the processor, for every
+    // parameter that changed since the last update().
+    std::atomic<std::uint64_t> changedParameters { ~std::uint64_t(0) };
+    std::array<juce::RangedAudioParameter*, 64> parametersByIndex {};
+    
+    std::vector<juce::RangedAudioParameter*> getAllParameters() const;
+    
+    // The layout of the binary state, which is fixed once and for all and
+    // has nothing to do with the order the parameters are created in.
+    // Parameters that are added later only ever go at the end of this list,
+    // so that the values of an older state still line up; the ones it
+    // doesn't have get their defaults. stateVersion only needs to go up when
+    // an existing value changes its meaning.
+    static constexpr const char* stateParameterIDs[] = {
+        "gain", "delayTime", "mix", "feedback", "stereo", "lowCut", "highCut",
+        "tempoSync", "delayNote", "bypass", "pingPong", "delayMode", "crossfade", "trails",
+        "tap1Time", "tap1Level", "tap1Pan", "tap1Note",
+        "tap2Time", "tap2Level", "tap2Pan", "tap2Note",
+        "tap3Time", "tap3Level", "tap3Pan", "tap3Note",
+        "tap4Time", "tap4Level", "tap4Pan", "tap4Note",
+    };
+    static constexpr int numParameters = int(std::size(stateParameterIDs));
+    static constexpr std::uint32_t stateTag = 0x53796c44;  // "DlyS", little-endian
+    static constexpr std::uint32_t stateVersion = 1;
+    
+    struct State
+    {
+        std::uint32_t tag;
+        std::uint32_t version;
+        std::uint32_t numValues;
+        float values[numParameters];
+    };
+    static constexpr int stateHeaderSize = int(offsetof(State, values));
+    
+    std::array<juce::RangedAudioParameter*, numParameters> stateParameters {};
+    void setValue(const juce::AudioProcessorParameter* param, float value) noexcept;
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int, bool) override { }
 };
@@ -4,7 +4,8 @@
 DelayAudioProcessorEditor::DelayAudioProcessorEditor (DelayAudioProcessor& p)
     : AudioProcessorEditor (&p),
       audioProcessor (p),
-      meter(p.levelL, p.levelR)
+      meter(p.levels),
+      scopeView(p.scope)
 {
     delayGroup.setText("Delay");
     delayGroup.setTextLabelPosition(juce::Justification::horizontallyCentred);
@@ -25,6 +26,7 @@ DelayAudioProcessorEditor::DelayAudioProcessorEditor (DelayAudioProcessor& p)
     outputGroup.addAndMakeVisible(gainKnob);
     outputGroup.addAndMakeVisible(mixKnob);
     outputGroup.addAndMakeVisible(meter);
+    outputGroup.addAndMakeVisible(scopeView);
     addAndMakeVisible(outputGroup);
 
     tempoSyncButton.setButtonText("Sync");
@@ -33,13 +35,20 @@ DelayAudioProcessorEditor::DelayAudioProcessorEditor (DelayAudioProcessor& p)
     tempoSyncButton.setLookAndFeel(ButtonLookAndFeel::get());
     delayGroup.addAndMakeVisible(tempoSyncButton);
     
+    pingPongButton.setButtonText("Ping-Pong");
+    pingPongButton.setClickingTogglesState(true);
+    pingPongButton.setBounds(0, 0, 70, 27);
+    pingPongButton.setLookAndFeel(ButtonLookAndFeel::get());
+    delayGroup.addAndMakeVisible(pingPongButton);
+    
     auto bypassIcon = juce::ImageCache::getFromMemory(BinaryData::Bypass_png, BinaryData::Bypass_pngSize);
     bypassButton.setClickingTogglesState(true);
     bypassButton.setBounds(0, 0, 20, 20);
     bypassButton.setImages(false, true, true, bypassIcon, 1.0f, juce::Colours::white, bypassIcon, 1.0f, juce::Colours::white, bypassIcon, 1.0f, juce::Colours::grey, 0.0f);
     addAndMakeVisible(bypassButton);
 
-    setSize(500, 330);
+    setOpaque(true);
+    setSize(700, 330);
 
     //gainKnob.slider.setColour(juce::Slider::rotarySliderFillColourId, juce::Colours::green);
 
@@ -58,6 +67,26 @@ DelayAudioProcessorEditor::~DelayAudioProcessorEditor()
 //==============================================================================
 void DelayAudioProcessorEditor::paint (juce::Graphics& g)
 {
+    // Nothing in the background ever moves, so it's only drawn again when
+    // the size or the display scale changes. Otherwise it's a single blit.
+    float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (background.isNull() || scale != backgroundScale) {
+        renderBackground(scale);
+    }
+    g.drawImage(background, getLocalBounds().toFloat());
+}
+
+void DelayAudioProcessorEditor::renderBackground(float scale)
+{
+    background = juce::Image(juce::Image::RGB,
+                             std::max(1, juce::roundToInt(float(getWidth()) * scale)),
+                             std::max(1, juce::roundToInt(float(getHeight()) * scale)),
+                             false);
+    backgroundScale = scale;
+    
+    juce::Graphics g(background);
+    g.addTransform(juce::AffineTransform::scale(scale));
+    
     auto noise = juce::ImageCache::getFromMemory(
         BinaryData::Noise_png, BinaryData::Noise_pngSize);
     auto fillType = juce::FillType(noise, juce::AffineTransform::scale(0.5f));
@@ -81,6 +110,7 @@ void DelayAudioProcessorEditor::paint (juce::Graphics& g)
 void DelayAudioProcessorEditor::resized()
 {
     auto bounds = getLocalBounds();
+    background = juce::Image();
 
     int y = 50;
     int height = bounds.getHeight() - 60;
@@ -88,7 +118,7 @@ void DelayAudioProcessorEditor::resized()
     // Position the groups
     delayGroup.setBounds(10, y, 110, height);
 
-    outputGroup.setBounds(bounds.getWidth() - 160, y, 150, height);
+    outputGroup.setBounds(bounds.getWidth() - 360, y, 350, height);
 
     feedbackGroup.setBounds(delayGroup.getRight() + 10, y,
                             outputGroup.getX() - delayGroup.getRight() - 20,
@@ -97,6 +127,7 @@ void DelayAudioProcessorEditor::resized()
     // Position the knobs inside the groups
     delayTimeKnob.setTopLeftPosition(20, 20);
     tempoSyncButton.setTopLeftPosition(20, delayTimeKnob.getBottom() + 10);
+    pingPongButton.setTopLeftPosition(20, tempoSyncButton.getBottom() + 10);
     delayNoteKnob.setTopLeftPosition(delayTimeKnob.getX(), delayTimeKnob.getY());
     mixKnob.setTopLeftPosition(20, 20);
     gainKnob.setTopLeftPosition(mixKnob.getX(), mixKnob.getBottom() + 10);
@@ -105,6 +136,8 @@ void DelayAudioProcessorEditor::resized()
     lowCutKnob.setTopLeftPosition(feedbackKnob.getX(), feedbackKnob.getBottom() + 10);
     highCutKnob.setTopLeftPosition(lowCutKnob.getRight() + 20, lowCutKnob.getY());
     meter.setBounds(outputGroup.getWidth() - 45, 30, 30, gainKnob.getBottom() - 30);
+    scopeView.setBounds(mixKnob.getRight() + 20, 30, meter.getX() - mixKnob.getRight() - 30,
+                        gainKnob.getBottom() - 30);
     bypassButton.setTopLeftPosition(bounds.getRight() - bypassButton.getWidth() - 10, 10);
 }
 
@@ -6,6 +6,7 @@
 #include "RotaryKnob.h"
 #include "LookAndFeel.h"
 #include "LevelMeter.h"
+#include "DelayScopeView.h"
 
 class DelayAudioProcessorEditor : public juce::AudioProcessorEditor,
 private juce::AudioProcessorParameter::Listener 
@@ -22,9 +23,14 @@ private:
     void parameterGestureChanged(int, bool) override { }
     
     void updateDelayKnobs(bool tempoSyncActive);
+    void renderBackground(float scale);
     
     DelayAudioProcessor& audioProcessor;
     
+    // The background and header, rendered at the display's pixel scale.
+    juce::Image background;
+    float backgroundScale = 0.0f;
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayAudioProcessorEditor)
     
     RotaryKnob gainKnob{ "Gain", audioProcessor.apvts, gainParamID, true };
@@ -39,6 +45,10 @@ private:
     juce::TextButton tempoSyncButton;
     
     juce::AudioProcessorValueTreeState::ButtonAttachment tempoSyncAttachment { audioProcessor.apvts, tempoSyncParamID.getParamID(), tempoSyncButton };
+    
+    juce::TextButton pingPongButton;
+    
+    juce::AudioProcessorValueTreeState::ButtonAttachment pingPongAttachment { audioProcessor.apvts, pingPongParamID.getParamID(), pingPongButton };
     juce::ImageButton bypassButton;
     
     juce::AudioProcessorValueTreeState::ButtonAttachment bypassAttahment {
@@ -48,6 +58,7 @@ private:
     juce::GroupComponent delayGroup, feedbackGroup, outputGroup;
     
     LevelMeter meter;
+    DelayScopeView scopeView;
     
     MainLookAndFeel mainLF;
     
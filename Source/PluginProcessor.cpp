@@ -1,9 +1,25 @@
 #include "PluginProcessor.h"
-#include "PluginEditor.h"
+#if ! DELAY_HEADLESS
+ #include "PluginEditor.h"
+#endif
 #include "ProtectYourEars.h"
+#include "DSP.h"
 
 #define VARY_DRY_WET 0 // Switch between different dry wet implementations
 
+// The parameters that decide how long the delay lines must be.
+static juce::StringArray getDelayTimeParameterIDs()
+{
+    juce::StringArray ids { delayTimeParamID.getParamID(), delayNoteParamID.getParamID(),
+                            tempoSyncParamID.getParamID() };
+    for (int i = 0; i < Parameters::numTaps; ++i) {
+        ids.add(tapParamID(i, "Time").getParamID());
+        ids.add(tapParamID(i, "Level").getParamID());
+        ids.add(tapParamID(i, "Note").getParamID());
+    }
+    return ids;
+}
+
 DelayAudioProcessor::DelayAudioProcessor() :
     AudioProcessor(
                    BusesProperties()
@@ -12,8 +28,16 @@ DelayAudioProcessor::DelayAudioProcessor() :
                    ),
                     params(apvts)
 {
-    lowCutFilter.setType(juce::dsp::StateVariableTPTFilterType::highpass);
-    highCutFilter.setType(juce::dsp::StateVariableTPTFilterType::lowpass);
+    for (const auto& id : getDelayTimeParameterIDs()) {
+        apvts.addParameterListener(id, this);
+    }
+    startTimer(timerInterval);
+}
+
+static float getPeak(const float* data, int numSamples) noexcept
+{
+    auto range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+    return std::max(-range.getStart(), range.getEnd());
 }
 
 static juce::String stringFromMilliseconds(float value, int)
@@ -71,6 +95,10 @@ static float hzFromString(const juce::String& str)
 
 DelayAudioProcessor::~DelayAudioProcessor()
 {
+    stopTimer();
+    for (const auto& id : getDelayTimeParameterIDs()) {
+        apvts.removeParameterListener(id, this);
+    }
 }
 
 //==============================================================================
@@ -108,7 +136,7 @@ bool DelayAudioProcessor::isMidiEffect() const
 
 double DelayAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLengthSeconds.load();
 }
 
 int DelayAudioProcessor::getNumPrograms()
@@ -138,55 +166,118 @@ void DelayAudioProcessor::changeProgramName (int, const  juce::String& )
 //==============================================================================
 void DelayAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    params.prepareToPlay(sampleRate);
+    double minDelayInSamples = Parameters::minDelayTime / 1000.0 * sampleRate;
+    int lookahead = 4 * DelayLine::maxOversampling;
+    maxSegmentSize = std::max(1, std::min(samplesPerBlock, int(minDelayInSamples) - lookahead));
+    
+    params.prepareToPlay(sampleRate, maxSegmentSize);
     params.reset();
-    tempo.reset();
+    params.update();
+    tempo.prepare(sampleRate);
+    minSyncedDelay = float(minDelayInSamples);
+    maxSyncedDelay = float(Parameters::maxDelayTime / 1000.0 * sampleRate);
+    
+    feedbackFilter.prepare(sampleRate);
+    glideCoeff = 1.0 - std::exp(-1.0 / (0.2 * sampleRate)); // 200 ms
+    for (auto& tapDelay : tapDelays) {
+        tapDelay.reset(sampleRate, 0.05);
+    }
+    resetDelayState();
+    
+    // A bypassed plug-in starts out idle. The delay lines are empty anyway.
+    silent = params.bypassed;
+    quietSamples = 0;
+    tailPeak = 0.0f;
+    tailDelay = -1.0f;
+    tailFeedback = -1.0f;
+    
+    bypassMix = params.bypassed ? 0.0f : 1.0f;
+    bypassMixInc = float(1.0 / (bypassFadeTime * sampleRate));
+    
+    {
+        const juce::ScopedLock lock(allocationLock);
+        
+        fullCapacity = int(std::ceil(Parameters::maxDelayTime / 1000.0 * sampleRate));
+        minCapacity = std::min(fullCapacity, int(std::ceil(minBufferTime * sampleRate)));
+        
+        // Sized for the settings as they are now. If the host's tempo turns
+        // out to need more, the timer takes care of it. Offline it's always
+        // the full size.
+        fixedCapacity.store(needsFullCapacity());
+        capacity = fixedCapacity.load() ? fullCapacity : getCapacityFor(getLongestDelay());
+        delayLineL.setMaximumDelayInSamples(capacity);
+        delayLineR.setMaximumDelayInSamples(capacity);
+        delayLineL.reset();
+        delayLineR.reset();
+        
+        preparedL.reset();
+        preparedR.reset();
+        hasPrepared.store(false);
+        shrinkCountdown = shrinkDelay;
+        delayNeeded.store(0.0f);
+        delayCapacity.store(capacity);
+    }
     
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = juce::uint32(samplesPerBlock);
-    spec.numChannels = 2;
+    delayBlock.prepare(maxSegmentSize);
+    fadeBlock.prepare(maxSegmentSize);
+    nextDelayBlock.prepare(maxSegmentSize);
+    nextFadeBlock.prepare(maxSegmentSize);
+    secondHead.resize(size_t(maxSegmentSize));
+    wetL.resize(size_t(maxSegmentSize));
+    wetR.resize(size_t(maxSegmentSize));
+    feedbackInL.resize(size_t(maxSegmentSize));
+    feedbackInR.resize(size_t(maxSegmentSize));
+    delayInputL.resize(size_t(maxSegmentSize));
+    delayInputR.resize(size_t(maxSegmentSize));
+    bypassBlock.prepare(maxSegmentSize);
+    dryL.resize(size_t(maxSegmentSize));
+    dryR.resize(size_t(maxSegmentSize));
+    bypassInputL.resize(size_t(maxSegmentSize));
+    bypassInputR.resize(size_t(maxSegmentSize));
     
-    lowCutFilter.prepare(spec);
-    lowCutFilter.reset();
+    meterAnalyzer.prepare(std::max(1, samplesPerBlock));
+    meterFrameLength = std::max(1, int(sampleRate / 1000.0));
+    scope.reset();
+}
 
-    highCutFilter.prepare(spec);
-    highCutFilter.reset();
+// Everything in the feedback loop apart from the delay lines themselves.
+void DelayAudioProcessor::resetDelayState() noexcept
+{
+    feedbackFilter.reset();
     
     feedbackL = 0.0f;
     feedbackR = 0.0f;
     
-    lastLowCut = -1.0f;
-    lastHighCut = -1.0f;
-    
-    double numSamples = Parameters::maxDelayTime / 1000.0 * sampleRate;
-    int maxDelayInSamples = int(std::ceil(numSamples));
-    delayLineL.setMaximumDelayInSamples(maxDelayInSamples);
-    delayLineR.setMaximumDelayInSamples(maxDelayInSamples);
-    delayLineL.reset();
-    delayLineR.reset();
-    
     delayInSamples = 0.0f;
     targetDelay = 0.0f;
     
-    fade = 1.0f;
-    fadeTarget = 1.0f;
+    nextDelay = 0.0f;
+    crossfading = false;
+    twoHeads = false;
+    xfade = 0.0f;
+    xfadeInc = 0.0f;
     
-    coeff = 1.0f - std::exp(-1.0f / (0.05 * float(sampleRate))); // 300 ms
-    wait = 0.0f;
-    waitInc = 1.0f / (0.3f * float(sampleRate)); // 300 ms
+    glideDelay = 0.0;
+    previousDelay = 0.0f;
+    oversampling = 1;
     
-//    xfade = 0.0f;
-//    xfadeInc = static_cast<float>(1.0 / (0.05 * sampleRate)); // 50 ms
-    
-    levelL.reset();
-    levelR.reset();
+    for (auto& tapDelay : tapDelays) {
+        tapDelay.setCurrentAndTargetValue(0.0f);
+    }
+    numActiveTaps = 0;
 }
 
 void DelayAudioProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    const juce::ScopedLock lock(allocationLock);
+    
+    delayLineL.release();
+    delayLineR.release();
+    preparedL.reset();
+    preparedR.reset();
+    hasPrepared.store(false);
+    capacity = 0;
+    delayCapacity.store(0);
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -214,15 +305,54 @@ void DelayAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, [[mayb
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
     
-    params.update();
+    // Parameters that have timestamped changes in this block start from
+    // where they were and move at those timestamps instead.
+    std::uint64_t automated = 0;
+    for (int i = 0; i < numParameterChanges; ++i) {
+        automated |= Parameters::parameterBit(parameterChanges[i].parameterIndex);
+    }
+    int nextChange = 0;
+    
+    params.update(automated);
     tempo.update(getPlayHead());
-    if (params.bypassed) { return; }
+    hostTempo.store(tempo.getTempo(), std::memory_order_relaxed);
+    updateScopeSettings();
+    
+    // Bypassed, with the fade done and nothing left in the delay lines: the
+    // input passes straight through. Only a mono input going to a stereo
+    // output needs copying.
+    if (params.bypassed && silent) {
+        bypassMix = 0.0f;
+        if (totalNumInputChannels == 1 && totalNumOutputChannels > 1) {
+            buffer.copyFrom(1, 0, buffer, 0, 0, buffer.getNumSamples());
+        }
+        scope.writeSilence(buffer.getNumSamples());
+        applyParameterChanges(nextChange, std::numeric_limits<int>::max());
+        measureLevels(buffer);
+        return;
+    }
+    
+    // Silent input and a delay line that has died away: nothing to do until
+    // the input comes back.
+    inputSilent = isInputSilent(buffer);
+    if (silent) {
+        if (inputSilent) {
+            bypassMix = 1.0f;
+            buffer.clear();
+            scope.writeSilence(buffer.getNumSamples());
+            applyParameterChanges(nextChange, std::numeric_limits<int>::max());
+            return;
+        }
+        wakeUp();
+    }
     
-    float syncedTime = float(tempo.getMillisecondsForNoteLength(params.delayNote));
-    if (syncedTime > Parameters::maxDelayTime) {
-        syncedTime = Parameters::maxDelayTime;
+    // Once fully bypassed, the tail is only fed silence.
+    if (params.bypassed && bypassMix == 0.0f) {
+        inputSilent = true;
     }
     
+    updateCapacity();
+    
     float sampleRate = float(getSampleRate());
     
     auto mainInput = getBusBuffer(buffer, true, 0);
@@ -237,176 +367,787 @@ void DelayAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, [[mayb
     float* outputDataL = mainOutput.getWritePointer(0);
     float* outputDataR = mainOutput.getWritePointer(isMainOutputStereo ? 1 : 0);
     
-    float maxL = 0.0f;
-    float maxR = 0.0f;
-    float max = 0.0f;
+    // Pick the kernel for this channel layout once for the whole block.
+    Kernel kernel = selectKernel(isMainInputStereo, isMainOutputStereo, params.pingPong);
     
-    if (isMainOutputStereo) {
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample) {
-            params.smoothen();
-            
-//            float delayTime = params.tempoSync ? syncedTime : params.delayTime;
-//            float delayInSamples = delayTime / 1000.0f * sampleRate;
-            
-            float delayTime = params.tempoSync ? syncedTime : params.delayTime;
-            float newTargetDelay = delayTime / 1000.0f * sampleRate;
-            
-            if (newTargetDelay != targetDelay) {
-                targetDelay = newTargetDelay;
-                
-                if (delayInSamples == 0.0f) { // First time
-                    delayInSamples = targetDelay;
-                } else {
-                    wait = waitInc; // Start counter
-                    fadeTarget = 0.0f; // Fade Out
-                }
-            }
+    // Control-rate pass first, then the audio kernel, one segment at a time.
+    // Segments also end where a timestamped parameter change happens.
+    int numSamples = buffer.getNumSamples();
+    for (int start = 0; start < numSamples; ) {
+        if (applyParameterChanges(nextChange, start)) {
+            kernel = selectKernel(isMainInputStereo, isMainOutputStereo, params.pingPong);
+        }
+        
+        int end = std::min(numSamples, start + maxSegmentSize);
+        if (nextChange < numParameterChanges) {
+            end = std::min(end, parameterChanges[nextChange].sampleOffset);
+        }
+        int segmentSize = end - start;
+        
+        params.smoothen(segmentSize);
+        xfadeInc = 1000.0f / (params.crossfadeTime * sampleRate);
+        
+        // Until a bigger buffer is swapped in, a longer delay is held at
+        // what the current one can do.
+        float delay = params.tempoSync ? getSyncedDelay(params.delayNote)
+                                       : params.delayTime / 1000.0f * sampleRate;
+        float newTargetDelay = std::min(delay, float(capacity));
+        
+        if (newTargetDelay != targetDelay) {
+            targetDelay = newTargetDelay;
             
-            if (params.lowCut != lastLowCut) {
-                lowCutFilter.setCutoffFrequency(params.lowCut);
-                lastLowCut = params.lowCut;
-            }
-            if (params.highCut != lastHighCut) {
-                highCutFilter.setCutoffFrequency(params.highCut);
-                lastHighCut = params.highCut;
+            if (delayInSamples == 0.0f) { // First time
+                delayInSamples = targetDelay;
             }
-            
-            float dryL = inputDataL[sample];
-            float dryR = inputDataR[sample];
-            
-            float mono = (dryL + dryR) * 0.5; // Convert stereo to mono
-            
-            delayLineL.write(mono*params.panL + feedbackR);
-            delayLineR.write(mono*params.panR + feedbackL);
-            
-            float wetL = delayLineL.read(delayInSamples);
-            float wetR = delayLineR.read(delayInSamples);
-            
-            fade += (fadeTarget - fade) * coeff;
-            
-            wetL *= fade;
-            wetR *= fade;
-            
-            if (wait > 0.0f) {
-                wait += waitInc;
-                if (wait >= 1.0f) {
-                    delayInSamples = targetDelay;
-                    wait = 0.0f;
-                    fadeTarget = 1.0f;
-                }
+        }
+        
+        // A crossfade that's under way when the mode changes gets to finish.
+        if (params.repitch && !crossfading) {
+            updateDelayGlide(segmentSize);
+        } else {
+            updateCrossfade(segmentSize);
+        }
+        updateTaps(segmentSize, isMainOutputStereo);
+        
+        if (bypassMix == 1.0f && !params.bypassed) {
+            (this->*kernel)(inputDataL + start, inputDataR + start,
+                            outputDataL + start, outputDataR + start, segmentSize);
+        } else {
+            processBypassSegment(kernel, inputDataL + start, inputDataR + start,
+                                 outputDataL + start, outputDataR + start, segmentSize);
+        }
+        
+        start = end;
+    }
+    
+    // Changes timestamped past the end of the block.
+    applyParameterChanges(nextChange, std::numeric_limits<int>::max());
+    
+    updateTail(numSamples);
+    
+    // Without trails, the delay lines are done with as soon as the fade is.
+    if (params.bypassed && bypassMix == 0.0f && !params.trails && !silent) {
+        delayLineL.reset();
+        delayLineR.reset();
+        resetDelayState();
+        silent = true;
+    }
+    
+    measureLevels(buffer);
+    
+    #if JUCE_DEBUG
+        protectYourEars(buffer);
+    #endif
+}
+
+void DelayAudioProcessor::setParameterChanges(const Parameters::Change* changes, int numChanges) noexcept
+{
+    parameterChanges = changes;
+    numParameterChanges = changes != nullptr ? numChanges : 0;
+}
+
+// Runs the kernel while fading between its output and the dry input. With
+// trails on, the input to the kernel is faded instead, and the dry signal
+// takes its place in the output, which leaves the echoes alone. The kernel
+// may process in place, so the dry input is copied first.
+void DelayAudioProcessor::processBypassSegment(Kernel kernel, const float* inputDataL, const float* inputDataR,
+                                               float* outputDataL, float* outputDataR, int numSamples) noexcept
+{
+    float target = params.bypassed ? 0.0f : 1.0f;
+    if (bypassMix == target) {
+        bypassBlock.setConstant(target);
+    } else {
+        float* data = bypassBlock.startRamp();
+        for (int i = 0; i < numSamples; ++i) {
+            if (bypassMix < target) {
+                bypassMix = std::min(bypassMix + bypassMixInc, target);
+            } else {
+                bypassMix = std::max(bypassMix - bypassMixInc, target);
             }
-            
-            feedbackL = wetL * params.feedback;
-            feedbackL = lowCutFilter.processSample(0, feedbackL);
-            feedbackL = highCutFilter.processSample(0, feedbackL);
+            data[i] = bypassMix;
+        }
+        bypassBlock.endRamp(numSamples);
+    }
+    
+    bool stereo = outputDataR != outputDataL;
+    juce::FloatVectorOperations::copy(dryL.data(), inputDataL, numSamples);
+    if (stereo) {
+        juce::FloatVectorOperations::copy(dryR.data(), inputDataR, numSamples);
+    }
+    
+    if (params.trails) {
+        // out = kernel(dry * mix) + dry - dry * mix
+        bypassBlock.multiply(bypassInputL.data(), dryL.data(), numSamples);
+        const float* fadedInputR = bypassInputL.data();
+        if (inputDataR != inputDataL) {
+            bypassBlock.multiply(bypassInputR.data(), dryR.data(), numSamples);
+            fadedInputR = bypassInputR.data();
+        }
+        (this->*kernel)(bypassInputL.data(), fadedInputR, outputDataL, outputDataR, numSamples);
+        
+        juce::FloatVectorOperations::add(outputDataL, dryL.data(), numSamples);
+        juce::FloatVectorOperations::subtract(outputDataL, bypassInputL.data(), numSamples);
+        if (stereo) {
+            juce::FloatVectorOperations::add(outputDataR, dryR.data(), numSamples);
+            juce::FloatVectorOperations::subtract(outputDataR, fadedInputR, numSamples);
+        }
+    } else {
+        // out = dry + (kernel(dry) - dry) * mix
+        (this->*kernel)(inputDataL, inputDataR, outputDataL, outputDataR, numSamples);
+        
+        juce::FloatVectorOperations::subtract(outputDataL, dryL.data(), numSamples);
+        bypassBlock.applyTo(outputDataL, numSamples);
+        juce::FloatVectorOperations::add(outputDataL, dryL.data(), numSamples);
+        if (stereo) {
+            juce::FloatVectorOperations::subtract(outputDataR, dryR.data(), numSamples);
+            bypassBlock.applyTo(outputDataR, numSamples);
+            juce::FloatVectorOperations::add(outputDataR, dryR.data(), numSamples);
+        }
+    }
+}
+
+bool DelayAudioProcessor::applyParameterChanges(int& nextChange, int position) noexcept
+{
+    bool applied = false;
+    while (nextChange < numParameterChanges && parameterChanges[nextChange].sampleOffset <= position) {
+        jassert(nextChange == 0 || parameterChanges[nextChange].sampleOffset
+                                   >= parameterChanges[nextChange - 1].sampleOffset);
+        params.applyChange(parameterChanges[nextChange]);
+        ++nextChange;
+        applied = true;
+    }
+    
+    // They only count for one block.
+    if (nextChange == numParameterChanges) {
+        parameterChanges = nullptr;
+        numParameterChanges = 0;
+        nextChange = 0;
+    }
+    return applied;
+}
+
+// Metering runs once over the finished block, rather than in pieces
+// between the segments. Blocks shorter than a millisecond are measured
+// together, so that tiny blocks at high sample rates can't fill up the
+// FIFO before the meter gets to read it.
+void DelayAudioProcessor::measureLevels(juce::AudioBuffer<float>& buffer) noexcept
+{
+    auto mainOutput = getBusBuffer(buffer, false, 0);
+    int numSamples = mainOutput.getNumSamples();
+    meterAnalyzer.process(0, mainOutput.getReadPointer(0), numSamples);
+    if (mainOutput.getNumChannels() > 1) {
+        meterAnalyzer.process(1, mainOutput.getReadPointer(1), numSamples);
+    }
+    if (meterAnalyzer.getNumSamples() >= meterFrameLength) {
+        levels.push(meterAnalyzer.finishFrame());
+    }
+}
+
+bool DelayAudioProcessor::isInputSilent(juce::AudioBuffer<float>& buffer) const noexcept
+{
+    if (buffer.hasBeenCleared()) { return true; }
+    
+    auto mainInput = getBusBuffer(buffer, true, 0);
+    for (int channel = 0; channel < mainInput.getNumChannels(); ++channel) {
+        if (mainInput.getMagnitude(channel, 0, mainInput.getNumSamples()) > silenceThreshold) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Starts over from silence. The delay lines are already clear, so the
+// parameters and read heads can jump straight to where they should be.
+// That includes the automated parameters: they start from their current
+// values, and the timestamped changes move them on from there.
+void DelayAudioProcessor::wakeUp() noexcept
+{
+    params.reset();
+    params.update(0);
+    resetDelayState();
+    silent = false;
+    quietSamples = 0;
+}
+
+// Keeps count of how long everything written into the delay lines has been
+// below the silence threshold. Once that covers the whole ring, there is
+// nothing left that could be heard, and the processor goes idle. Also keeps
+// the tail length up to date for the host.
+void DelayAudioProcessor::updateTail(int numSamples) noexcept
+{
+    if (inputSilent && tailPeak <= silenceThreshold) {
+        quietSamples += numSamples;
+    } else {
+        quietSamples = 0;
+    }
+    tailPeak = 0.0f;
+    
+    if (quietSamples > delayLineL.getBufferLength()) {
+        delayLineL.reset();
+        delayLineR.reset();
+        resetDelayState();
+        silent = true;
+    }
+    
+    // The tail is the longest delay, plus as many round trips of the main
+    // delay as the feedback takes to fall below the silence threshold. The
+    // feedback filters only make it shorter.
+    float delay = getLongestDelay();
+    float feedback = std::abs(params.feedback.value);
+    if (delay != tailDelay || feedback != tailFeedback) {
+        tailDelay = delay;
+        tailFeedback = feedback;
+        
+        double repeats = 0.0;
+        if (feedback >= 0.999f) {
+            repeats = std::numeric_limits<double>::infinity();
+        } else if (feedback > 0.0f) {
+            repeats = std::log(double(silenceThreshold)) / std::log(double(feedback));
+        }
+        double mainDelay = params.tempoSync ? getSyncedTime() : params.getTargetDelayTime();
+        tailLengthSeconds.store(double(delay) / getSampleRate() + repeats * mainDelay / 1000.0);
+    }
+}
+
+float DelayAudioProcessor::getSyncedTime() const noexcept
+{
+    float time = float(tempo.getMillisecondsForNoteLength(params.delayNote));
+    return juce::jlimit(Parameters::minDelayTime, Parameters::maxDelayTime, time);
+}
 
-            feedbackR = wetR * params.feedback;
-            feedbackR = lowCutFilter.processSample(1, feedbackR);
-            feedbackR = highCutFilter.processSample(1, feedbackR);
+// The same in samples, for any note length, straight from the tempo's table.
+float DelayAudioProcessor::getSyncedDelay(int note) const noexcept
+{
+    float delay = float(tempo.getSamplesForNoteLength(note));
+    return juce::jlimit(minSyncedDelay, maxSyncedDelay, delay);
+}
 
-            // Dry/wet where dry is constant and wet is varied
-            float mixL = dryL + wetL * params.mix;
-            float mixR = dryR + wetR * params.mix;
+// The settings the delay line display draws with. Taps that are turned
+// down have no marker.
+void DelayAudioProcessor::updateScopeSettings() noexcept
+{
+    scope.sampleRate.store(float(getSampleRate()), std::memory_order_relaxed);
+    scope.delayTime.store(params.tempoSync ? getSyncedTime() : params.getTargetDelayTime(),
+                          std::memory_order_relaxed);
+    for (size_t i = 0; i < params.taps.size(); ++i) {
+        const auto& tap = params.taps[i];
+        scope.tapTimes[i].store(tap.enabled ? getTapTime(tap) : 0.0f, std::memory_order_relaxed);
+    }
+    scope.feedback.store(params.feedback.value, std::memory_order_relaxed);
+    scope.lowCut.store(params.lowCut.value, std::memory_order_relaxed);
+    scope.highCut.store(params.highCut.value, std::memory_order_relaxed);
+}
+
+void DelayAudioProcessor::updateCrossfade(int numSamples) noexcept
+{
+    previousDelay = delayInSamples;
+    oversampling = 1;
+    
+    // Nothing to do unless the delay time changed.
+    if (!crossfading && (delayInSamples == targetDelay || params.repitch)) {
+        delayBlock.setConstant(delayInSamples);
+        fadeBlock.setConstant(1.0f);
+        twoHeads = false;
+        return;
+    }
+    
+    float* delays = delayBlock.startRamp();
+    float* fades = fadeBlock.startRamp();
+    float* nextDelays = nextDelayBlock.startRamp();
+    float* nextFades = nextFadeBlock.startRamp();
+    
+    for (int sample = 0; sample < numSamples; ++sample) {
+        // Start a new crossfade. A target that arrives while one is going on
+        // waits its turn, so the heads never have to jump.
+        if (!crossfading && delayInSamples != targetDelay && !params.repitch) {
+            nextDelay = targetDelay;
+            xfade = 0.0f;
+            crossfading = true;
+        }
+        
+        delays[sample] = delayInSamples;
+        
+        if (crossfading) {
+            xfade = std::min(xfade + xfadeInc, 1.0f);
             
-            float outL = mixL * params.gain;
-            float outR = mixR * params.gain;
+            // Equal power, since the two heads aren't correlated.
+            fades[sample] = quarterCosine(xfade);
+            nextFades[sample] = quarterCosine(1.0f - xfade);
+            nextDelays[sample] = nextDelay;
             
-            if (params.bypassed) {
-                outL = dryL;
-                outR = dryR;
+            if (xfade == 1.0f) {
+                delayInSamples = nextDelay;
+                crossfading = false;
             }
-            
-//            outL = fade;
-//            outR = fade;
-            
-            outputDataL[sample] = outL;
-            outputDataR[sample] = outR;
-            
-            maxL = std::max(maxL, std::abs(outL));
-            maxR = std::max(maxR, std::abs(outR));
+        } else {
+            fades[sample] = 1.0f;
+            nextFades[sample] = 0.0f;
+            nextDelays[sample] = delayInSamples;
         }
+    }
+    
+    delayBlock.endRamp(numSamples);
+    fadeBlock.endRamp(numSamples);
+    nextDelayBlock.endRamp(numSamples);
+    nextFadeBlock.endRamp(numSamples);
+    
+    // The heads usually hold still during the segment, and then the reads
+    // don't need to gather.
+    delayBlock.collapse(numSamples);
+    nextDelayBlock.collapse(numSamples);
+    twoHeads = true;
+}
+
+void DelayAudioProcessor::updateDelayGlide(int numSamples) noexcept
+{
+    previousDelay = delayInSamples;
+    oversampling = 1;
+    twoHeads = false;
+    fadeBlock.setConstant(1.0f);
+    
+    if (delayInSamples == targetDelay) {
+        delayBlock.setConstant(delayInSamples);
+        return;
+    }
+    
+    // Pick up where crossfade mode left the delay.
+    if (float(glideDelay) != delayInSamples) {
+        glideDelay = delayInSamples;
+    }
+    
+    float* delays = delayBlock.startRamp();
+    double fastest = 0.0;
+    
+    for (int sample = 0; sample < numSamples; ++sample) {
+        double step = (double(targetDelay) - glideDelay) * glideCoeff;
+        step = juce::jlimit(1.0 - maxHeadSpeed, 1.0 - minHeadSpeed, step);
+        glideDelay += step;
+        fastest = std::max(fastest, std::abs(1.0 - step));
+        
+        if (std::abs(double(targetDelay) - glideDelay) < 1e-3) {
+            glideDelay = targetDelay;
+        }
+        delays[sample] = float(glideDelay);
+    }
+    
+    delayInSamples = float(glideDelay);
+    delayBlock.endRamp(numSamples);
+    
+    // Only pay for the wider interpolator while the head runs fast, in
+    // either direction. The long tail of the glide is so close to normal
+    // speed that it doesn't alias.
+    if (fastest > 1.1) {
+        oversampling = std::min(params.oversampling, fastest > 2.0 ? 4 : 2);
+    }
+}
+
+void DelayAudioProcessor::readHead(const DelayLine& delayLine, const BlockValue& delays, float previous,
+                                   float* output, int numSamples) const noexcept
+{
+    if (params.repitch) {
+        if (delays.ramping) {
+            delayLine.readBlockBandLimited(output, delays.values.data(), previous, numSamples, oversampling);
+        } else {
+            delayLine.readBlockBandLimited(output, delays.value, numSamples);
+        }
+    } else if (delays.ramping) {
+        delayLine.readBlock(output, delays.values.data(), numSamples);
     } else {
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample) {
-            params.smoothen();
-            
-//            float delayTime = params.tempoSync ? syncedTime : params.delayTime;
-//            float delayInSamples = delayTime / 1000.0f * sampleRate;
-            
-            float delayTime = params.tempoSync ? syncedTime : params.delayTime;
-            float newTargetDelay = delayTime / 1000.0f * sampleRate;
-            
-            if (newTargetDelay != targetDelay) {
-                targetDelay = newTargetDelay;
-                
-                if (delayInSamples == 0.0f) { // First time
-                    delayInSamples = targetDelay;
-                } else {
-                    wait = waitInc; // Start counter
-                    fadeTarget = 0.0f; // Fade Out
+        delayLine.readBlock(output, delays.value, numSamples);
+    }
+}
+
+void DelayAudioProcessor::readDelayLine(const DelayLine& delayLine, float* output, int numSamples) noexcept
+{
+    readHead(delayLine, delayBlock, previousDelay, output, numSamples);
+    fadeBlock.applyTo(output, numSamples);
+    
+    // During a crossfade the second head fades in.
+    if (twoHeads) {
+        readHead(delayLine, nextDelayBlock, nextDelayBlock.at(0), secondHead.data(), numSamples);
+        nextFadeBlock.applyTo(secondHead.data(), numSamples);
+        juce::FloatVectorOperations::add(output, secondHead.data(), numSamples);
+    }
+}
+
+template<bool stereoIn, bool stereoOut, bool pingPong>
+void DelayAudioProcessor::processKernel(const float* inputDataL, const float* inputDataR,
+                                        float* outputDataL, float* outputDataR, int numSamples) noexcept
+{
+    static_assert(stereoOut || !(stereoIn || pingPong), "mono output has no stereo modes");
+    
+    // Dual mono (mono in, stereo out, no ping-pong) only needs one delay line.
+    constexpr bool twoLines = stereoIn || pingPong;
+    
+    readDelayLine(delayLineL, wetL.data(), numSamples);
+    if constexpr (twoLines) {
+        readDelayLine(delayLineR, wetR.data(), numSamples);
+    }
+    
+    params.feedback.multiply(feedbackInL.data(), wetL.data(), numSamples);
+    if constexpr (twoLines) {
+        params.feedback.multiply(feedbackInR.data(), wetR.data(), numSamples);
+    }
+    
+    // The extra taps only go to the output, so they come in after the
+    // feedback has been split off.
+    if constexpr (twoLines) {
+        delayLineL.addTaps(wetL.data(), tapsL.data(), numActiveTaps, numSamples);
+        delayLineR.addTaps(wetR.data(), tapsR.data(), numActiveTaps, numSamples);
+    } else if constexpr (stereoOut) {
+        juce::FloatVectorOperations::copy(wetR.data(), wetL.data(), numSamples);
+        delayLineL.addTaps(wetL.data(), tapsL.data(), numActiveTaps, numSamples);
+        delayLineL.addTaps(wetR.data(), tapsR.data(), numActiveTaps, numSamples);
+    } else {
+        delayLineL.addTaps(wetL.data(), tapsL.data(), numActiveTaps, numSamples);
+    }
+    
+    if constexpr (pingPong) {
+        // Convert stereo to mono and pan it.
+        const float* mono = inputDataL;
+        if constexpr (stereoIn) {
+            juce::FloatVectorOperations::add(delayInputL.data(), inputDataL, inputDataR, numSamples);
+            juce::FloatVectorOperations::multiply(delayInputL.data(), 0.5f, numSamples);
+            mono = delayInputL.data();
+        }
+        params.panR.multiply(delayInputR.data(), mono, numSamples);
+        params.panL.multiply(delayInputL.data(), mono, numSamples);
+    } else {
+        juce::FloatVectorOperations::copy(delayInputL.data(), inputDataL, numSamples);
+        if constexpr (stereoIn) {
+            juce::FloatVectorOperations::copy(delayInputR.data(), inputDataR, numSamples);
+        }
+    }
+    
+    // The feedback loop is the only part that has to go sample by sample.
+    // The channels go through the filters together, in lanes 0 and 1.
+    alignas(16) float frame[FeedbackFilter::numLanes] = {};
+    for (int start = 0; start < numSamples; ) {
+        int end = updateFilterCutoffs(start, numSamples);
+        for (int sample = start; sample < end; ++sample) {
+            if constexpr (pingPong) {
+                delayInputL[size_t(sample)] += feedbackR;
+                delayInputR[size_t(sample)] += feedbackL;
+            } else {
+                delayInputL[size_t(sample)] += feedbackL;
+                if constexpr (twoLines) {
+                    delayInputR[size_t(sample)] += feedbackR;
                 }
             }
             
-            lowCutFilter.setCutoffFrequency(params.lowCut);
-            highCutFilter.setCutoffFrequency(params.highCut);
-            
-            float dry = inputDataL[sample];
-            delayLineL.write(dry + feedbackL);
-            
-            float wet = delayLineL.read(delayInSamples);
-            feedbackL = wet * params.feedback;
-            feedbackL = lowCutFilter.processSample(0, feedbackL);
-            feedbackL = highCutFilter.processSample(0, feedbackL);
-            
-            fade += (fadeTarget - fade) * coeff;
-            
-            wet *= fade;
+            frame[0] = feedbackInL[size_t(sample)];
+            if constexpr (twoLines) {
+                frame[1] = feedbackInR[size_t(sample)];
+            }
+            feedbackFilter.process(frame);
+            feedbackL = frame[0];
+            if constexpr (twoLines) {
+                feedbackR = frame[1];
+            }
+        }
+        start = end;
+    }
+    
+    delayLineL.writeBlock(delayInputL.data(), numSamples);
+    if constexpr (twoLines) {
+        delayLineR.writeBlock(delayInputR.data(), numSamples);
+    }
+    scope.write(delayInputL.data(), twoLines ? delayInputR.data() : delayInputL.data(), numSamples);
+    
+    // Only worth measuring once the input has gone quiet.
+    if (inputSilent) {
+        tailPeak = std::max(tailPeak, getPeak(delayInputL.data(), numSamples));
+        if constexpr (twoLines) {
+            tailPeak = std::max(tailPeak, getPeak(delayInputR.data(), numSamples));
+        }
+    }
+    
+    // Dry/wet where dry is constant and wet is varied. The right channel goes
+    // first: with a mono input, inputDataL is the same channel as outputDataL.
+    params.mix.applyTo(wetL.data(), numSamples);
+    if constexpr (stereoOut) {
+        params.mix.applyTo(wetR.data(), numSamples);
+        juce::FloatVectorOperations::add(outputDataR, stereoIn ? inputDataR : inputDataL, wetR.data(), numSamples);
+    }
+    juce::FloatVectorOperations::add(outputDataL, inputDataL, wetL.data(), numSamples);
+    
+    params.gain.applyTo(outputDataL, numSamples);
+    if constexpr (stereoOut) {
+        params.gain.applyTo(outputDataR, numSamples);
+    }
+}
+
+DelayAudioProcessor::Kernel DelayAudioProcessor::selectKernel(bool stereoIn, bool stereoOut, bool pingPong) const noexcept
+{
+    if (!stereoOut) {
+        return &DelayAudioProcessor::processKernel<false, false, false>;
+    }
+    if (stereoIn) {
+        return pingPong ? &DelayAudioProcessor::processKernel<true, true, true>
+                        : &DelayAudioProcessor::processKernel<true, true, false>;
+    }
+    return pingPong ? &DelayAudioProcessor::processKernel<false, true, true>
+                    : &DelayAudioProcessor::processKernel<false, true, false>;
+}
+
+void DelayAudioProcessor::updateTaps(int numSamples, bool isStereo) noexcept
+{
+    numActiveTaps = 0;
+    
+    for (size_t i = 0; i < params.taps.size(); ++i) {
+        const auto& tap = params.taps[i];
+        
+        // Changing a tap's time glides to the new delay instead of jumping.
+        auto& tapDelay = tapDelays[i];
+        float target = std::min(getTapDelay(tap), float(capacity));
+        if (tapDelay.getCurrentValue() == 0.0f) { // First time
+            tapDelay.setCurrentAndTargetValue(target);
+        } else {
+            tapDelay.setTargetValue(target);
+        }
+        float startDelay = tapDelay.getCurrentValue();
+        float endDelay = tapDelay.skip(numSamples);
+        
+        if (!tap.active) { continue; }
+        
+        auto& left = tapsL[size_t(numActiveTaps)];
+        auto& right = tapsR[size_t(numActiveTaps)];
+        ++numActiveTaps;
+        
+        left.delayInSamples = startDelay;
+        left.delayIncrement = (endDelay - startDelay) / float(numSamples);
+        right.delayInSamples = left.delayInSamples;
+        right.delayIncrement = left.delayIncrement;
+        
+        if (isStereo) {
+            left.gain = tap.gainL;
+            left.gainIncrement = tap.gainIncrementL;
+            right.gain = tap.gainR;
+            right.gainIncrement = tap.gainIncrementR;
+        } else {
+            left.gain = 0.5f * (tap.gainL + tap.gainR);
+            left.gainIncrement = 0.5f * (tap.gainIncrementL + tap.gainIncrementR);
+        }
+    }
+}
+
+float DelayAudioProcessor::getTapTime(const Parameters::Tap& tap) const noexcept
+{
+    if (params.tempoSync) {
+        float time = float(tempo.getMillisecondsForNoteLength(tap.note));
+        return juce::jlimit(Parameters::minDelayTime, Parameters::maxDelayTime, time);
+    }
+    return tap.time;
+}
+
+float DelayAudioProcessor::getTapDelay(const Parameters::Tap& tap) const noexcept
+{
+    if (params.tempoSync) {
+        return getSyncedDelay(tap.note);
+    }
+    return tap.time / 1000.0f * float(getSampleRate());
+}
+
+// The longest delay in samples that the current settings ask for.
+float DelayAudioProcessor::getLongestDelay() const noexcept
+{
+    float delay = params.tempoSync ? getSyncedDelay(params.delayNote)
+                                   : params.getTargetDelayTime() / 1000.0f * float(getSampleRate());
+    for (const auto& tap : params.taps) {
+        if (tap.enabled) {
+            delay = std::max(delay, getTapDelay(tap));
+        }
+    }
+    return delay;
+}
+
+// The longest delay any read head is at or moving towards right now. A
+// smaller buffer can only be swapped in once it holds all of these.
+float DelayAudioProcessor::getLongestDelayInUse() const noexcept
+{
+    float delay = std::max(delayInSamples, targetDelay);
+    if (crossfading) {
+        delay = std::max(delay, nextDelay);
+    }
+    for (size_t i = 0; i < params.taps.size(); ++i) {
+        if (params.taps[i].active) {
+            delay = std::max({ delay, tapDelays[i].getCurrentValue(), tapDelays[i].getTargetValue() });
+        }
+    }
+    return delay;
+}
+
+int DelayAudioProcessor::getCapacityFor(float delay) const noexcept
+{
+    int size = int(std::ceil(delay * headroom));
+    return juce::jlimit(minCapacity, fullCapacity, size);
+}
+
+void DelayAudioProcessor::updateCapacity() noexcept
+{
+    if (fixedCapacity.load(std::memory_order_relaxed)) { return; }
+    
+    // The host went offline without preparing again, or calls processBlock()
+    // from the message thread, so the timer can't run in between. Neither
+    // is a real-time thread, so the buffers can be allocated right here.
+    if (needsFullCapacity() || juce::MessageManager::existsAndIsCurrentThread()) {
+        useFullCapacity();
+        return;
+    }
+    
+    float needed = getLongestDelay();
+    
+    if (hasPrepared.load(std::memory_order_acquire)) {
+        // Shrinking can't cut off a head that's still reading, and a buffer
+        // that was prepared for a smaller delay than is needed by now is only
+        // worth taking if it's at least bigger than the current one.
+        bool fits = float(preparedCapacity) >= getLongestDelayInUse();
+        bool helps = float(preparedCapacity) >= needed || preparedCapacity > capacity;
+        if (fits && helps) {
+            delayLineL.swapBuffer(preparedL, preparedCapacity);
+            delayLineR.swapBuffer(preparedR, preparedCapacity);
+            capacity = preparedCapacity;
             
-            if (wait > 0.0f) {
-                wait += waitInc;
-                if (wait >= 1.0f) {
-                    delayInSamples = targetDelay;
-                    wait = 0.0f;
-                    fadeTarget = 1.0f;
+            // A tap that's turned off isn't in the check above, but it may
+            // still be gliding from a longer time. If it comes back on, it
+            // must start inside the new buffer.
+            for (auto& tapDelay : tapDelays) {
+                if (tapDelay.getCurrentValue() > float(capacity)) {
+                    tapDelay.setCurrentAndTargetValue(float(capacity));
                 }
             }
-            
-            float mix = dry + wet * params.mix;
-            
-            float out = mix * params.gain;
-            
-            outputDataL[sample] = out;
-            
-            max = std::max(max, std::abs(out));
         }
+        hasPrepared.store(false, std::memory_order_release);
     }
     
-    levelL.updateIfGreater(maxL);
-    levelR.updateIfGreater(maxR);
+    delayNeeded.store(needed);
+    delayCapacity.store(capacity);
+}
+
+// Offline renders run faster than real time, and without a message loop
+// the timer never runs at all.
+bool DelayAudioProcessor::needsFullCapacity() const noexcept
+{
+    return isNonRealtime() || juce::MessageManager::getInstanceWithoutCreating() == nullptr;
+}
+
+// Grows the delay lines to hold the longest delay there is, keeping what's
+// in them. This allocates, so it's not for the real-time audio thread.
+void DelayAudioProcessor::useFullCapacity()
+{
+    const juce::ScopedLock lock(allocationLock);
     
-    #if JUCE_DEBUG
-        protectYourEars(buffer);
-    #endif
+    auto bufferL = DelayLine::allocateBuffer(fullCapacity);
+    auto bufferR = DelayLine::allocateBuffer(fullCapacity);
+    delayLineL.swapBuffer(bufferL, fullCapacity);
+    delayLineR.swapBuffer(bufferR, fullCapacity);
+    capacity = fullCapacity;
+    
+    preparedL.reset();
+    preparedR.reset();
+    hasPrepared.store(false);
+    fixedCapacity.store(true);
+    delayCapacity.store(capacity);
+}
+
+void DelayAudioProcessor::timerCallback()
+{
+    const juce::ScopedLock lock(allocationLock);
+    prepareBuffers(delayNeeded.load(), true);
+}
+
+// A longer time from the editor gets its buffers now rather than at the
+// next timer callback. Automation that comes in on the audio thread has to
+// wait for the timer.
+void DelayAudioProcessor::parameterChanged(const juce::String&, float)
+{
+    if (!juce::MessageManager::existsAndIsCurrentThread()) { return; }
+    
+    float needed = params.getRequestedDelayTime(hostTempo.load()) / 1000.0f * float(getSampleRate());
+    if (needed > float(delayCapacity.load())) {
+        const juce::ScopedLock lock(allocationLock);
+        prepareBuffers(needed, false);
+    }
+}
+
+// Allocates buffers for the audio thread to swap in, if the delay lines
+// are too short for needed or (when mayShrink is set) much too long. Only
+// call this on the message thread, with allocationLock held.
+void DelayAudioProcessor::prepareBuffers(float needed, bool mayShrink)
+{
+    // Still waiting for the audio thread to pick these up.
+    if (hasPrepared.load(std::memory_order_acquire)) { return; }
+    
+    // Whatever is left over from the last swap.
+    preparedL.reset();
+    preparedR.reset();
+    
+    int current = delayCapacity.load();
+    if (current == 0 || fixedCapacity.load()) { return; }  // not prepared to play, or full size
+    
+    int desired = getCapacityFor(needed);
+    
+    // Grow right away, but only shrink once the delay has been short for a
+    // while, so that sweeping the delay time doesn't keep reallocating.
+    if (needed > float(current)) {
+        shrinkCountdown = shrinkDelay;
+    } else if (!mayShrink) {
+        return;
+    } else if (current > 2 * desired) {
+        if (--shrinkCountdown > 0) { return; }
+        shrinkCountdown = shrinkDelay;
+    } else {
+        shrinkCountdown = shrinkDelay;
+        return;
+    }
+    
+    preparedL = DelayLine::allocateBuffer(desired);
+    preparedR = DelayLine::allocateBuffer(desired);
+    preparedCapacity = desired;
+    hasPrepared.store(true, std::memory_order_release);
+}
+
+int DelayAudioProcessor::updateFilterCutoffs(int start, int numSamples) noexcept
+{
+    feedbackFilter.setCutoffs(params.lowCut.at(start), params.highCut.at(start));
+    
+    // Returns where the next coefficient update is due.
+    if (params.lowCut.ramping || params.highCut.ramping) {
+        return std::min(numSamples, start + filterUpdateInterval);
+    }
+    return numSamples;
 }
 
 //==============================================================================
 bool DelayAudioProcessor::hasEditor() const
 {
+   #if DELAY_HEADLESS
+    return false; // built without the editor, e.g. for the benchmark
+   #else
     return true; // (change this to false if you choose to not supply an editor)
+   #endif
 }
 
 juce::AudioProcessorEditor* DelayAudioProcessor::createEditor()
 {
+   #if DELAY_HEADLESS
+    return nullptr;
+   #else
     return new DelayAudioProcessorEditor (*this);
+   #endif
 }
 
 //==============================================================================
 void DelayAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    copyXmlToBinary(*apvts.copyState().createXml(), destData);
+    params.writeState(destData);
 }
 
 void DelayAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    if (params.readState(data, sizeInBytes)) { return; }
+    
+    // Sessions saved before the binary format stored the state as XML.
     std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
     if (xml.get() != nullptr && xml->hasTagName(apvts.state.getType())) {
         apvts.replaceState(juce::ValueTree::fromXml(*xml));
@@ -475,6 +1216,33 @@ juce::AudioProcessorValueTreeState::ParameterLayout
         // Bypass parameter
         layout.add(std::make_unique<juce::AudioParameterBool>(bypassParamID, "Bypass", false));
         
+        // Delay mode parameter
+        juce::StringArray delayModes = { "Crossfade", "Repitch", "Repitch 2x", "Repitch 4x" };
+        layout.add(std::make_unique<juce::AudioParameterChoice>(delayModeParamID, "Delay Mode", delayModes, 0));
+        
+        // Crossfade time parameter
+        layout.add(std::make_unique<juce::AudioParameterFloat>(crossfadeParamID, "Crossfade Time", juce::NormalisableRange<float> { 5.0f, 1000.0f, 0.001f, 0.4f }, 50.0f, juce::AudioParameterFloatAttributes().withStringFromValueFunction(stringFromMilliseconds).withValueFromStringFunction(millisecondsFromString)));
+        
+        // Ping-pong parameter
+        layout.add(std::make_unique<juce::AudioParameterBool>(pingPongParamID, "Ping-Pong", true));
+        
+        // Trails parameter. When on, bypassing lets the echoes ring out.
+        layout.add(std::make_unique<juce::AudioParameterBool>(trailsParamID, "Trails", false));
+        
+        // Multi-tap parameters. The taps are off by default and spread out
+        // over a bar.
+        for (int i = 0; i < numTaps; ++i) {
+            juce::String name = "Tap " + juce::String(i + 1);
+            
+            layout.add(std::make_unique<juce::AudioParameterFloat>(tapParamID(i, "Time"), name + " Time", juce::NormalisableRange<float> { minDelayTime, maxDelayTime, 0.001f, 0.25f }, 250.0f * float(i + 1), juce::AudioParameterFloatAttributes().withStringFromValueFunction(stringFromMilliseconds).withValueFromStringFunction(millisecondsFromString)));
+            
+            layout.add(std::make_unique<juce::AudioParameterFloat>(tapParamID(i, "Level"), name + " Level", juce::NormalisableRange<float>(0.0f, 100.0f, 1.0f), 0.0f, juce::AudioParameterFloatAttributes().withStringFromValueFunction(stringFromPercent)));
+            
+            layout.add(std::make_unique<juce::AudioParameterFloat>(tapParamID(i, "Pan"), name + " Pan", juce::NormalisableRange<float>(-100.0f, 100.0f, 1.0f), 0.0f, juce::AudioParameterFloatAttributes().withStringFromValueFunction(stringFromPercent)));
+            
+            layout.add(std::make_unique<juce::AudioParameterChoice>(tapParamID(i, "Note"), name + " Note", noteLengths, 6 + i * 3));
+        }
+        
         return layout;
 }
 
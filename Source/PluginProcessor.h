@@ -4,9 +4,13 @@
 #include "Parameters.h"
 #include "Tempo.h"
 #include "DelayLine.h"
+#include "FeedbackFilter.h"
 #include "Measurement.h"
+#include "MeterAnalyzer.h"
+#include "DelayScope.h"
 
-class DelayAudioProcessor  : public juce::AudioProcessor
+class DelayAudioProcessor  : public juce::AudioProcessor, private juce::Timer,
+                             private juce::AudioProcessorValueTreeState::Listener
 {
 public:
     //==============================================================================
@@ -52,33 +56,194 @@ public:
     
     juce::AudioProcessorParameter* getBypassParameter() const override;
     
+    // Sample-accurate automation. Whoever calls processBlock() and knows at
+    // which sample each parameter change happens can pass the changes for
+    // the next block here, sorted by sampleOffset. The block is then
+    // rendered in segments that start at exactly those samples. The array
+    // must stay valid until processBlock() returns. Without it, changes are
+    // picked up at the start of the block like before. (JUCE's plug-in
+    // wrappers don't pass on the host's timestamps.)
+    void setParameterChanges(const Parameters::Change* changes, int numChanges) noexcept;
+    
     Parameters params;
     
-    Measurement levelL, levelR;
+    // One frame per processed block, or per millisecond when the blocks are
+    // shorter, for the level meter.
+    Measurement levels;
+    
+    // The contents of the delay lines, for the editor's display.
+    DelayScope scope;
 
 private:
+    void updateCrossfade(int numSamples) noexcept;
+    void updateDelayGlide(int numSamples) noexcept;
+    void readHead(const DelayLine& delayLine, const BlockValue& delays, float previous,
+                  float* output, int numSamples) const noexcept;
+    void readDelayLine(const DelayLine& delayLine, float* output, int numSamples) noexcept;
+    
+    // The audio kernel, specialized for every layout isBusesLayoutSupported()
+    // accepts, so each version only does the work its layout needs. In
+    // ping-pong mode the input is summed to mono and panned, and the feedback
+    // crosses over between the channels. Otherwise every input channel has
+    // its own delay and feedback.
+    template<bool stereoIn, bool stereoOut, bool pingPong>
+    void processKernel(const float* inputDataL, const float* inputDataR,
+                       float* outputDataL, float* outputDataR, int numSamples) noexcept;
+    
+    using Kernel = void (DelayAudioProcessor::*)(const float*, const float*, float*, float*, int) noexcept;
+    Kernel selectKernel(bool stereoIn, bool stereoOut, bool pingPong) const noexcept;
+    
+    void processBypassSegment(Kernel kernel, const float* inputDataL, const float* inputDataR,
+                              float* outputDataL, float* outputDataR, int numSamples) noexcept;
+    
+    bool applyParameterChanges(int& nextChange, int position) noexcept;
+    void resetDelayState() noexcept;
+    void measureLevels(juce::AudioBuffer<float>& buffer) noexcept;
+    bool isInputSilent(juce::AudioBuffer<float>& buffer) const noexcept;
+    void wakeUp() noexcept;
+    void updateTail(int numSamples) noexcept;
+    float getSyncedTime() const noexcept;
+    float getSyncedDelay(int note) const noexcept;
+    void updateScopeSettings() noexcept;
+    
+    int updateFilterCutoffs(int start, int numSamples) noexcept;
+    void updateTaps(int numSamples, bool isStereo) noexcept;
+    float getTapTime(const Parameters::Tap& tap) const noexcept;
+    float getTapDelay(const Parameters::Tap& tap) const noexcept;
+    
+    float getLongestDelay() const noexcept;
+    float getLongestDelayInUse() const noexcept;
+    int getCapacityFor(float delayInSamples) const noexcept;
+    void updateCapacity() noexcept;
+    bool needsFullCapacity() const noexcept;
+    void useFullCapacity();
+    void prepareBuffers(float needed, bool mayShrink);
+    void timerCallback() override;
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
     
     Tempo tempo;
     
+    // The range of the delay time parameter in samples, which synced delays
+    // are held to as well.
+    float minSyncedDelay = 0.0f;
+    float maxSyncedDelay = 0.0f;
+    
+    const Parameters::Change* parameterChanges = nullptr;
+    int numParameterChanges = 0;
+    
+    // Silence detection. While silent, processBlock() only clears the
+    // output. tailPeak is the loudest sample written into the delay lines
+    // since the last updateTail(), only measured while the input is silent.
+    // That's -100 dB, or with compact storage, the level below which the
+    // delay lines store nothing.
+    static constexpr float silenceThreshold = std::max(1e-5f, DelayLine::silenceLevel);
+    bool silent = false;
+    bool inputSilent = false;
+    int quietSamples = 0;
+    float tailPeak = 0.0f;
+    float tailDelay = -1.0f;
+    float tailFeedback = -1.0f;
+    std::atomic<double> tailLengthSeconds { 0.0 };
+    
+    // Bypass fades between the processed and the dry signal rather than
+    // switching. bypassMix is 1 while processing and 0 when fully bypassed.
+    // With trails on, only the input to the delay is faded out, and the
+    // echoes that are already in the delay lines keep ringing. Once the
+    // fade is done (and the tail has died away), the processor goes silent
+    // and the audio passes straight through.
+    float bypassMix = 1.0f;
+    float bypassMixInc = 0.0f;
+    static constexpr double bypassFadeTime = 0.01;  // seconds
+    
     DelayLine delayLineL, delayLineR;
     
-    juce::dsp::StateVariableTPTFilter<float> lowCutFilter;
-    juce::dsp::StateVariableTPTFilter<float> highCutFilter;
+    // The delay lines only hold as much as the current settings need, plus
+    // some headroom, rather than the full 5 seconds. The audio thread tells
+    // the timer how long a delay it needs, and the timer allocates bigger
+    // (or, after a while, smaller) buffers in preparedL and preparedR. At the
+    // start of the next block the audio thread swaps them in, which leaves
+    // the old buffers in preparedL and preparedR for the timer to free.
+    // hasPrepared says which thread owns the prepared buffers. A longer time
+    // set from the editor is allocated for right away, by the parameter
+    // listener. Until a bigger buffer is in, the read heads are held at the
+    // end of the current one.
+    //
+    // Offline, and without a message loop to run the timer, none of this
+    // would keep up, so the delay lines are full size from the start and
+    // fixedCapacity is set.
+    int capacity = 0;  // longest delay the delay lines can hold, in samples
+    int fullCapacity = 0;
+    int minCapacity = 0;
+    std::atomic<bool> fixedCapacity { false };
+    std::atomic<double> hostTempo { 120.0 };
+    std::atomic<float> delayNeeded { 0.0f };
+    std::atomic<int> delayCapacity { 0 };
+    std::unique_ptr<DelayLine::Sample[]> preparedL, preparedR;
+    int preparedCapacity = 0;
+    std::atomic<bool> hasPrepared { false };
+    int shrinkCountdown = 0;
+    juce::CriticalSection allocationLock;
+    static constexpr int timerInterval = 20;     // milliseconds
+    static constexpr int shrinkDelay = 150;      // timer callbacks
+    static constexpr float headroom = 1.5f;
+    static constexpr double minBufferTime = 0.25;  // seconds
+    
+    FeedbackFilter feedbackFilter;
+    MeterAnalyzer meterAnalyzer;
+    int meterFrameLength = 1;  // samples
     
     float feedbackL = 0.0f;
     float feedbackR = 0.0f;
     
-    float lastLowCut = -1.0f;
-    float lastHighCut = -1.0f;
+    // While the cutoffs are being smoothed, the filter coefficients are only
+    // recalculated every this many samples.
+    static constexpr int filterUpdateInterval = 16;
     
     float delayInSamples = 0.0f;
     float targetDelay = 0.0f;
 
-    float fade = 0.0f;
-    float fadeTarget = 0.0f;
-    float coeff = 0.0f;
-    float wait = 0.0f;
-    float waitInc = 0.0f;
+    // When the delay time changes, a second read head starts at the new
+    // delay and the two are crossfaded. Then the second head becomes the
+    // first one.
+    float nextDelay = 0.0f;
+    bool crossfading = false;
+    bool twoHeads = false;  // a crossfade happens somewhere in this segment
+    float xfade = 0.0f;
+    float xfadeInc = 0.0f;
+    
+    // Repitch mode. The glide runs in double precision, because in float a
+    // one-pole smoother stalls far from its target at long delays. The head
+    // speed is limited to two octaves either way.
+    double glideDelay = 0.0;
+    double glideCoeff = 0.0;
+    float previousDelay = 0.0f;
+    int oversampling = 1;
+    static constexpr double minHeadSpeed = 0.25;
+    static constexpr double maxHeadSpeed = 4.0;
+    
+    // The feedback path reads a whole segment from the delay line before it
+    // writes that segment, so segments can't be longer than the shortest
+    // possible delay, minus how far the widest interpolator reaches ahead.
+    int maxSegmentSize = 0;
+    
+    // The multi-tap section reads from delayLineL and delayLineR. Only the
+    // taps that are turned up are in tapsL and tapsR.
+    std::array<juce::LinearSmoothedValue<float>, Parameters::numTaps> tapDelays;
+    std::array<DelayLine::Tap, Parameters::numTaps> tapsL, tapsR;
+    int numActiveTaps = 0;
+    
+    // Per-segment control signals and scratch space for the audio kernel.
+    BlockValue delayBlock;
+    BlockValue fadeBlock;
+    BlockValue nextDelayBlock;
+    BlockValue nextFadeBlock;
+    std::vector<float> secondHead;
+    std::vector<float> wetL, wetR;
+    std::vector<float> feedbackInL, feedbackInR;
+    std::vector<float> delayInputL, delayInputR;
+    BlockValue bypassBlock;
+    std::vector<float> dryL, dryR;
+    std::vector<float> bypassInputL, bypassInputR;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayAudioProcessor)
 };
@@ -0,0 +1,154 @@
+#include "RefreshScheduler.h"
+
+RefreshScheduler::~RefreshScheduler()
+{
+    stopTimer();
+}
+
+void RefreshScheduler::add(RefreshClient* client)
+{
+    clients.add(client);
+    if (!isTimerRunning()) {
+        startTimerHz(fallbackRate);
+    }
+    attach();
+}
+
+void RefreshScheduler::remove(RefreshClient* client)
+{
+    // A client may stop itself from inside refresh(). Then the slot is only
+    // emptied here, and tick() removes it when it's done.
+    int index = clients.indexOf(client);
+    if (ticking) {
+        clients.set(index, nullptr);
+    } else {
+        clients.remove(index);
+    }
+    
+   #if JUCE_MAJOR_VERSION >= 7
+    if (attachedTo == &client->component) {
+        syncTo(nullptr);
+        attach();
+    }
+   #endif
+    
+    if (clients.isEmpty()) {
+        stopTimer();
+    }
+}
+
+// Syncs to the display of the first client that is on screen, unless the
+// one it's synced to now still is.
+void RefreshScheduler::attach()
+{
+   #if JUCE_MAJOR_VERSION >= 7
+    if (attachedTo != nullptr && attachedTo->isShowing()) { return; }
+    
+    for (auto* client : clients) {
+        if (client != nullptr && client->component.isShowing()) {
+            syncTo(&client->component);
+            return;
+        }
+    }
+   #endif
+}
+
+// The old attachment isn't deleted right away, because this may be called
+// from inside its callback. The timer gets rid of it later.
+void RefreshScheduler::syncTo([[maybe_unused]] juce::Component* component)
+{
+   #if JUCE_MAJOR_VERSION >= 7
+    if (vblank != nullptr) {
+        retired.add(vblank.release());
+    }
+    attachedTo = component;
+    if (component != nullptr) {
+        vblank = std::make_unique<juce::VBlankAttachment>(component, [this]
+        {
+            lastVBlank = juce::Time::getMillisecondCounterHiRes();
+            tick();
+        });
+    }
+   #endif
+}
+
+void RefreshScheduler::tick()
+{
+    double now = juce::Time::getMillisecondCounterHiRes();
+    tickInterval = juce::jlimit(0.0, 50.0, now - lastTick);
+    lastTick = now;
+    
+    // Refreshes can't be timed more precisely than the ticks come in, so a
+    // client is due from half a tick before its time. Otherwise a client at
+    // the display's own rate would miss every other vblank due to jitter.
+    double slack = tickInterval * 0.5;
+    
+    ticking = true;
+    for (int i = 0; i < clients.size(); ++i) {
+        auto* client = clients[i];
+        if (client != nullptr && now + slack >= client->nextRefresh) {
+            client->nextRefresh = std::max(client->nextRefresh + client->interval,
+                                           now + client->interval * 0.5);
+            client->refresh();
+        }
+    }
+    ticking = false;
+    
+    clients.removeAllInstancesOf(nullptr);
+    if (clients.isEmpty()) {
+        stopTimer();
+    }
+}
+
+void RefreshScheduler::timerCallback()
+{
+   #if JUCE_MAJOR_VERSION >= 7
+    retired.clear();
+   #endif
+    
+    double now = juce::Time::getMillisecondCounterHiRes();
+    if (now - lastVBlank < watchdogInterval) {
+        if (getTimerInterval() != watchdogInterval) {
+            startTimer(watchdogInterval);
+        }
+        return;
+    }
+    
+    // No vblanks lately: the window may have moved, or the component that
+    // was synced to went off screen.
+    attach();
+    if (getTimerInterval() == watchdogInterval) {
+        startTimerHz(fallbackRate);
+    }
+    tick();
+}
+
+RefreshClient::RefreshClient(juce::Component& component_) : component(component_)
+{
+}
+
+RefreshClient::~RefreshClient()
+{
+    stopRefresh();
+}
+
+void RefreshClient::startRefreshHz(int rate)
+{
+    double now = juce::Time::getMillisecondCounterHiRes();
+    interval = 1000.0 / rate;
+    if (registered) {
+        nextRefresh = std::min(nextRefresh, now + interval);
+    } else {
+        nextRefresh = now + interval;
+        registered = true;
+        scheduler->add(this);
+    }
+}
+
+void RefreshClient::stopRefresh()
+{
+    if (registered) {
+        registered = false;
+        scheduler->remove(this);
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+class RefreshClient;
+
+// One refresh driver for every meter and visualizer in the process, instead
+// of a juce::Timer per component. It runs off the display's vertical blank
+// through a juce::VBlankAttachment on one of its visible clients, and falls
+// back to a timer when none of them is on screen. On every vblank, all the
+// clients that are due get called in one go, so their repaints end up in
+// the same paint of the window. There is only ever one of these, shared
+// through a juce::SharedResourcePointer.
+class RefreshScheduler : private juce::Timer
+{
+public:
+    RefreshScheduler() = default;
+    ~RefreshScheduler() override;
+
+private:
+    friend class RefreshClient;
+    
+    void add(RefreshClient* client);
+    void remove(RefreshClient* client);
+    void attach();
+    void syncTo(juce::Component* component);
+    void tick();
+    void timerCallback() override;
+    
+    juce::Array<RefreshClient*> clients;
+    bool ticking = false;
+    
+   #if JUCE_MAJOR_VERSION >= 7
+    std::unique_ptr<juce::VBlankAttachment> vblank;
+    juce::OwnedArray<juce::VBlankAttachment> retired;
+    juce::Component* attachedTo = nullptr;
+   #endif
+    double lastVBlank = 0.0;
+    double lastTick = 0.0;
+    double tickInterval = 0.0;
+    
+    // While vblanks come in, the timer only checks now and then that they
+    // still do. Without them, it drives the clients itself.
+    static constexpr int fallbackRate = 60;
+    static constexpr int watchdogInterval = 100;  // milliseconds
+    
+    JUCE_DECLARE_NON_COPYABLE(RefreshScheduler)
+};
+
+// Derive from this instead of juce::Timer, and use startRefreshHz() and
+// refresh() where it would be startTimerHz() and timerCallback().
+class RefreshClient
+{
+public:
+    explicit RefreshClient(juce::Component& component);
+    virtual ~RefreshClient();
+    
+    virtual void refresh() = 0;
+    
+    // Calls refresh() up to rate times per second, but no more than once
+    // per vblank.
+    void startRefreshHz(int rate);
+    void stopRefresh();
+
+private:
+    friend class RefreshScheduler;
+    
+    juce::Component& component;
+    juce::SharedResourcePointer<RefreshScheduler> scheduler;
+    double interval = 0.0;  // milliseconds
+    double nextRefresh = 0.0;
+    bool registered = false;
+    
+    JUCE_DECLARE_NON_COPYABLE(RefreshClient)
+};
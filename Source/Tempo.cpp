@@ -1,14 +1,44 @@
 #include "Tempo.h"
 
+static std::array<double, Tempo::numNoteLengths> noteLengthMultipliers =
+{
+    0.125,        //  0 = 1/32
+    0.5 / 3.0,    //  1 = 1/16 triplet
+    0.1875,       //  2 = 1/32 dotted
+    0.25,         //  3 = 1/16
+    1.0 / 3.0,    //  4 = 1/8 triplet
+    0.375,        //  5 = 1/16 dotted
+    0.5,          //  6 = 1/8
+    2.0 / 3.0,    //  7 = 1/4 triplet
+    0.75,         //  8 = 1/8 dotted
+    1.0,          //  9 = 1/4
+    4.0 / 3.0,    // 10 = 1/2 triplet
+    1.5,          // 11 = 1/4 dotted
+    2.0,          // 12 = 1/2
+    8.0 / 3.0,    // 13 = 1/1 triplet
+    3.0,          // 14 = 1/2 dotted
+    4.0,          // 15 = 1/1
+};
+
+double Tempo::getMillisecondsForNoteLength(int index, double bpm) noexcept
+{
+    return 60000.0 / bpm * noteLengthMultipliers[size_t(index)];
+}
+
+void Tempo::prepare(double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate;
+    reset();
+}
+
 void Tempo::reset() noexcept
 {
-    bpm = 120;
+    bpm = 120.0;
+    updateNoteLengths();
 }
 
 void Tempo::update(const juce::AudioPlayHead* playhead) noexcept
 {
-    reset();
-    
     if (playhead == nullptr) { return; }
     
     const auto opt = playhead->getPosition();
@@ -18,31 +48,23 @@ void Tempo::update(const juce::AudioPlayHead* playhead) noexcept
     const auto& pos = *opt;
     
     if (pos.getBpm().hasValue()) {
-        bpm = *pos.getBpm();
+        setTempo(*pos.getBpm());
     }
 }
 
-static std::array<double, 16> noteLengthMultipliers =
+// Some hosts report a tempo of 0 while they're stopped.
+void Tempo::setTempo(double newBpm) noexcept
 {
-    0.125,        //  0 = 1/32
-    0.5 / 3.0,    //  1 = 1/16 triplet
-    0.1875,       //  2 = 1/32 dotted
-    0.25,         //  3 = 1/16
-    1.0 / 3.0,    //  4 = 1/8 triplet
-    0.375,        //  5 = 1/16 dotted
-    0.5,          //  6 = 1/8
-    2.0 / 3.0,    //  7 = 1/4 triplet
-    0.75,         //  8 = 1/8 dotted
-    1.0,          //  9 = 1/4
-    4.0 / 3.0,    // 10 = 1/2 triplet
-    1.5,          // 11 = 1/4 dotted
-    2.0,          // 12 = 1/2
-    8.0 / 3.0,    // 13 = 1/1 triplet
-    3.0,          // 14 = 1/2 dotted
-    4.0,          // 15 = 1/1
-};
+    if (newBpm > 0.0 && newBpm != bpm) {
+        bpm = newBpm;
+        updateNoteLengths();
+    }
+}
 
-double Tempo::getMillisecondsForNoteLength(int index) const noexcept
+void Tempo::updateNoteLengths() noexcept
 {
-    return 60000.0 * noteLengthMultipliers[size_t(index)] / bpm;
+    for (size_t i = 0; i < milliseconds.size(); ++i) {
+        milliseconds[i] = getMillisecondsForNoteLength(int(i), bpm);
+        samples[i] = milliseconds[i] / 1000.0 * sampleRate;
+    }
 }
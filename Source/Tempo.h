@@ -2,14 +2,34 @@
 
 #include <JuceHeader.h>
 
+// What the host says about its tempo. A host that doesn't report it in a
+// block keeps the last tempo it did report, and the delay times of all note
+// lengths are only worked out again when the tempo or the sample rate
+// changes, so looking one up costs nothing.
 class Tempo
 {
 public:
+    static constexpr int numNoteLengths = 16;
+    
+    void prepare(double sampleRate) noexcept;
+    
+    // Back to 120 BPM.
     void reset() noexcept;
     
     void update(const juce::AudioPlayHead* playhead) noexcept;
     
-    double getMillisecondsForNoteLength(int index) const noexcept;
+    double getMillisecondsForNoteLength(int index) const noexcept
+    {
+        return milliseconds[size_t(index)];
+    }
+    
+    double getSamplesForNoteLength(int index) const noexcept
+    {
+        return samples[size_t(index)];
+    }
+    
+    // The same at any tempo, for threads other than the audio thread.
+    static double getMillisecondsForNoteLength(int index, double bpm) noexcept;
     
     double getTempo() const noexcept
     {
@@ -17,5 +37,12 @@ public:
     }
     
 private:
-    double bpm = 120;
+    void setTempo(double newBpm) noexcept;
+    void updateNoteLengths() noexcept;
+    
+    double sampleRate = 44100.0;
+    double bpm = 120.0;
+    
+    std::array<double, numNoteLengths> milliseconds {};
+    std::array<double, numNoteLengths> samples {};
 };